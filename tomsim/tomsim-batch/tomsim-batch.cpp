@@ -0,0 +1,261 @@
+#include "iostream"
+#include "fstream"
+#include "sstream"
+#include "string"
+#include "vector"
+#include "set"
+#include "mutex"
+#include "algorithm"
+#include "cstdlib"
+
+#include "../tomsim/simulator.h"
+#include "../tomsim/threadpool.h"
+
+using namespace std;
+
+//Manifest, one job per line: the three arguments of tomsim
+/** # trace config output
+	traces/gcc.t configs/wide.json results/gcc-wide.json
+	traces/gcc.t configs/narrow.json results/gcc-narrow.json
+	...
+	the fields are separated by spaces or tabs, lines starting with # are comments
+**/
+struct batchJob {
+	std::string traceFile;
+	std::string configFile;
+	std::string outputFile;
+	unsigned long long estimatedLength = 0; //number of instructions of the trace, estimated from the size of the file
+};
+
+//Results file, one line per finished job in the order the jobs finish, the fields are separated by tabs
+/** status trace config output cycles reg_reads stalls
+	status is completed or failed, the statistics are empty for a failed job
+**/
+#define ResultsFields 7
+#define TextTraceLineSize 5 //bytes of one line of a text trace, 4 hex digits and the end of line
+
+//Results file shared by the workers, a line is written and flushed at once so an interrupted batch leaves whole lines
+struct resultsFile {
+	std::mutex lock;
+	ofstream file;
+};
+
+//returns true if the manifest is read properly
+static bool readManifest(const std::string& fileName, std::vector<batchJob>& jobs)
+{
+	string line;
+	ifstream manifestFile(fileName);
+	if (!manifestFile.is_open())
+	{
+		cout << "Cannot read the manifest file";
+		return false;
+	}
+	std::set<std::string> outputFiles;
+	while (getline(manifestFile, line))
+	{
+		batchJob job;
+		std::string extra;
+		istringstream fields(line);
+		if (!(fields >> job.traceFile) || job.traceFile[0] == '#')
+		{
+			continue;
+		}
+		if (!(fields >> job.configFile >> job.outputFile) || (fields >> extra))
+		{
+			cout << "Invalid line in manifest file: " << line << endl;
+			return false;
+		}
+		//two jobs writing the same output file would overwrite each other
+		if (outputFiles.insert(job.outputFile).second == false)
+		{
+			cout << "Output file used by two jobs in manifest file: " << job.outputFile << endl;
+			return false;
+		}
+		jobs.push_back(job);
+	}
+	return true;
+}
+
+//Jobs already done by a previous run of the batch: the completed lines of the results file
+//A failed job is run again
+static void readCompletedJobs(const std::string& fileName, std::set<std::string>& completed)
+{
+	string line;
+	ifstream results(fileName);
+	while (getline(results, line))
+	{
+		std::vector<std::string> fields;
+		std::size_t position = 0;
+		while (position <= line.length())
+		{
+			std::size_t tab = line.find('\t', position);
+			if (tab == std::string::npos)
+			{
+				tab = line.length();
+			}
+			fields.push_back(line.substr(position, tab - position));
+			position = tab + 1;
+		}
+		//a line cut short by an interrupted batch does not count
+		if (fields.size() == ResultsFields && fields[0] == "completed" && !fields[6].empty())
+		{
+			completed.insert(fields[1] + '\t' + fields[2] + '\t' + fields[3]);
+		}
+	}
+}
+
+//Number of instructions of a trace, from the header of a binary trace or from the size of a text trace
+static unsigned long long estimateTraceLength(const std::string& fileName)
+{
+	ifstream traceFile(fileName, ios::binary);
+	traceBinaryHeader header;
+	if (traceFile.read((char*)&header, sizeof(header)) && std::equal(header.magic, header.magic + sizeof(header.magic), TraceBinaryMagic))
+	{
+		return header.instructionCount;
+	}
+	traceFile.clear();
+	traceFile.seekg(0, ios::end);
+	std::streamoff size = traceFile.tellg();
+	return size > 0 ? size / TextTraceLineSize : 0;
+}
+
+//Open the results file for appending, the header is written if the file is new
+//returns false if the file cannot be opened
+static bool openResultsFile(const std::string& fileName, resultsFile& results)
+{
+	ifstream existing(fileName, ios::binary);
+	bool isNew = !existing.is_open() || existing.peek() == ifstream::traits_type::eof();
+	//an interrupted batch may have left a partial line, the next line must not be appended to it
+	bool endsWithLine = true;
+	if (!isNew)
+	{
+		existing.seekg(-1, ios::end);
+		endsWithLine = existing.get() == '\n';
+	}
+	existing.close();
+	results.file.open(fileName, ios::app);
+	if (!results.file.is_open())
+	{
+		cout << "Cannot open the results file";
+		return false;
+	}
+	if (isNew)
+	{
+		results.file << "#status\ttrace\tconfig\toutput\tcycles\treg reads\tstalls" << endl;
+	}
+	else if (!endsWithLine)
+	{
+		results.file << endl;
+	}
+	return true;
+}
+
+//Run one job like tomsim does and append its line to the results file
+//The output file is written before the line, so a job with a completed line has its output file
+static void runBatchJob(const batchJob& job, allocationPolicy policy, resultsFile& results)
+{
+	Simulator simulator;
+	//a job may deadlock, the event driven mode detects it instead of running forever, its statistics are the same as
+	//cycle by cycle so the output file is the one tomsim writes
+	simulator.eventDriven = true;
+	simulator.functionalUnitPolicy = policy;
+	simulator.decodeThreads = 1; //the jobs already run on all the hardware threads
+	bool completed = false;
+	//a malformed number in the config or the trace throws, it only fails this job and not the batch
+	try
+	{
+		completed = simulator.readConfigFile(job.configFile) && simulator.readTraceFile(job.traceFile) &&
+			simulator.executeProgram();
+		if (completed)
+		{
+			simulator.WriteOutputFile(job.outputFile);
+		}
+	}
+	catch (const std::exception& error)
+	{
+		completed = false;
+		cout << "Error in job " << job.traceFile << " " << job.configFile << ": " << error.what() << endl;
+	}
+	ostringstream line;
+	line << (completed ? "completed" : "failed") << '\t' << job.traceFile << '\t' << job.configFile << '\t' << job.outputFile << '\t';
+	if (completed)
+	{
+		line << simulator.totalNumberOfClockCycles << '\t' << simulator.numberOfOperandReadFromRegisterFile << '\t'
+			<< simulator.numberOfStructuralHazardStalls;
+	}
+	else
+	{
+		line << "\t\t";
+	}
+	line << '\n';
+	std::lock_guard<std::mutex> guard(results.lock);
+	results.file << line.str() << flush;
+}
+
+//Run every job of a manifest, each job is one simulation with the arguments tomsim would get
+//The jobs run on a pool of threads, the longest traces first so a long job does not start last and keep the batch
+//waiting. Each job appends its line to the results file when it finishes; running the batch again skips the jobs
+//which already have a completed line, so an interrupted batch resumes where it stopped.
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		cout << "Usage: " << argv[0] << " <manifestFile> <resultsFile> [--threads <n>] [--allocation lowest|round-robin|lru]";
+		return 0;
+	}
+	int numberOfThreads = defaultNumberOfThreads();
+	allocationPolicy policy = LowestIndex;
+	for (int i = 3; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--threads" && i + 1 < argc)
+		{
+			numberOfThreads = std::atoi(argv[++i]);
+		}
+		else if (option == "--allocation" && i + 1 < argc)
+		{
+			if (parseAllocationPolicy(argv[++i], policy) == false)
+			{
+				cout << "Unknown allocation policy: " << argv[i] << endl;
+				return 0;
+			}
+		}
+		else
+		{
+			cout << "Unknown option: " << option << endl;
+			return 0;
+		}
+	}
+	std::vector<batchJob> jobs;
+	if (readManifest(argv[1], jobs) == false)
+	{
+		return 0;
+	}
+	std::set<std::string> completed;
+	readCompletedJobs(argv[2], completed);
+	std::vector<int> pending;
+	for (int i = 0; i < (int)jobs.size(); i++)
+	{
+		if (completed.count(jobs[i].traceFile + '\t' + jobs[i].configFile + '\t' + jobs[i].outputFile) == 0)
+		{
+			jobs[i].estimatedLength = estimateTraceLength(jobs[i].traceFile);
+			pending.push_back(i);
+		}
+	}
+	cout << "Jobs: " << jobs.size() << ", already completed: " << jobs.size() - pending.size() << endl;
+	//longest first, the manifest order among traces of the same length
+	std::stable_sort(pending.begin(), pending.end(), [&jobs](int a, int b)
+	{
+		return jobs[a].estimatedLength > jobs[b].estimatedLength;
+	});
+	resultsFile results;
+	if (openResultsFile(argv[2], results) == false)
+	{
+		return 0;
+	}
+	runJobs(pending, numberOfThreads, [&](int index)
+	{
+		runBatchJob(jobs[index], policy, results);
+	});
+	results.file.close();
+}
@@ -0,0 +1,496 @@
+#include "iostream"
+#include "fstream"
+#include "sstream"
+#include "string"
+#include "vector"
+#include "map"
+#include "chrono"
+#include "iomanip"
+#include "algorithm"
+#include "cstdlib"
+#include "cstring"
+#include "functional"
+
+#ifdef _WIN32
+#include "windows.h"
+#include "psapi.h"
+#endif
+
+#include "../tomsim/simulator.h"
+#include "../tomsim/generator.h"
+
+using namespace std;
+
+//One benchmark of the corpus: a machine and a synthetic trace
+/** The traces are generated from a fixed seed (see generator.h), so the corpus is the same on every run and on every
+	host. The dependencies are one way, and the seeds below are ones whose traces drain.
+**/
+struct benchmarkMachine {
+	int numberOfUnits;
+	int numberOfReservationStations;
+	int latency;
+};
+
+struct benchmark {
+	const char* name;
+	benchmarkMachine machine[FUType];
+	int mix[FUType]; //relative weight of the instructions of each type of FU in the trace
+	double dependency;
+	int distance;
+	unsigned long long length; //number of instructions
+	unsigned long long seed;
+};
+
+static const benchmark corpus[] = {
+	//the machine of configuration.json
+	{ "small", { { 2, 4, 2 }, { 1, 2, 4 }, { 1, 2, 3 }, { 1, 2, 5 }, { 1, 2, 2 } }, { 6, 1, 1, 2, 1 }, 0.5, 4, 1000000, 1 },
+	//many reservation stations, mostly independent instructions: a large window of active instructions
+	{ "wide-window", { { 8, 64, 1 }, { 2, 16, 8 }, { 4, 32, 3 }, { 4, 32, 4 }, { 2, 16, 2 } }, { 6, 1, 2, 3, 1 }, 0.2, 32, 1000000, 4 },
+	//slow dividers, multipliers and loads, the instructions stay long in the execute stage
+	{ "long-latency", { { 2, 8, 2 }, { 2, 16, 40 }, { 2, 16, 20 }, { 2, 16, 60 }, { 1, 8, 10 } }, { 3, 2, 2, 3, 1 }, 0.3, 8, 400000, 3 },
+	//every operand is the result of the last producer, the pipeline mostly waits for operands
+	{ "dependency-heavy", { { 2, 4, 2 }, { 1, 2, 4 }, { 1, 2, 3 }, { 1, 2, 5 }, { 1, 2, 2 } }, { 6, 1, 1, 2, 1 }, 1.0, 1, 1000000, 4 },
+};
+
+//RS scaling series: the long latency trace on machines which only differ by their number of reservation stations, the
+//same for every type of FU. The slow units keep the stations full, so the window of active instructions grows with
+//them. Each benchmark is named after the series and its number of stations, "rs-scaling-64"
+static const benchmark rsScaling = { "rs-scaling", { { 2, 0, 2 }, { 2, 0, 40 }, { 2, 0, 20 }, { 2, 0, 60 }, { 1, 0, 10 } }, { 3, 2, 2, 3, 1 }, 0.3, 8, 400000, 3 };
+static const int rsScalingStations[] = { 4, 16, 64, 256 };
+
+//Results file, one line per benchmark, the fields are separated by tabs
+/** benchmark instructions cycles seconds instructions/s cycles/s peak_rss_kB
+	seconds is the best of the repeated runs, the rates are computed from it
+**/
+struct benchmarkResult {
+	std::string name;
+	unsigned long long instructions = 0;
+	long long cycles = 0;
+	double seconds = 0;
+	double instructionsPerSecond = 0;
+	double cyclesPerSecond = 0;
+	long long peakMemory = -1; //kB, -1 if the host cannot tell
+};
+
+//Write the trace of a benchmark in the text format of readTraceFile()
+//returns false if the file cannot be written
+static bool writeCorpusTrace(const benchmark& bench, const std::string& fileName)
+{
+	ofstream traceFile(fileName, ios::binary);
+	if (!traceFile.is_open())
+	{
+		cout << "Cannot write the corpus trace " << fileName << endl;
+		return false;
+	}
+	traceGeneratorSettings settings;
+	settings.length = bench.length;
+	settings.seed = bench.seed;
+	std::copy(bench.mix, bench.mix + FUType, settings.mix);
+	settings.dependencies = OneWay;
+	settings.dependency = bench.dependency;
+	settings.distances = UniformDistance;
+	settings.distance = bench.distance;
+	return generateTrace(settings, traceFile);
+}
+
+//Peak resident memory of the process in kB, -1 if the host cannot tell
+//On Linux the peak is reset before each benchmark, elsewhere it is the peak of the whole run so far
+static void resetPeakMemory()
+{
+#ifdef __linux__
+	ofstream clearRefs("/proc/self/clear_refs");
+	clearRefs << "5";
+#endif
+}
+
+static long long peakMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return counters.PeakWorkingSetSize / 1024;
+	}
+#elif defined(__linux__)
+	string line;
+	ifstream status("/proc/self/status");
+	while (getline(status, line))
+	{
+		if (line.compare(0, 6, "VmHWM:") == 0)
+		{
+			return std::atoll(line.c_str() + 6);
+		}
+	}
+#endif
+	return -1;
+}
+
+//Run one benchmark 'repeat' times like tomsim does, the trace is read from its file and simulated
+//returns false if a simulation fails
+static bool runBenchmark(const benchmark& bench, const std::string& traceFileName, int repeat, bool eventDriven,
+	benchmarkResult& result)
+{
+	result.name = bench.name;
+	result.instructions = bench.length;
+	for (int run = 0; run < repeat; run++)
+	{
+		resetPeakMemory();
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		{
+			Simulator simulator;
+			simulator.eventDriven = eventDriven;
+			simulator.decodeCacheConfig.enabled = false; //every run decodes the trace
+			for (int typeFU = 0; typeFU < FUType; typeFU++)
+			{
+				const benchmarkMachine& machine = bench.machine[typeFU];
+				simulator.addFunctionalUnits(typeFU, machine.numberOfUnits, machine.numberOfReservationStations, machine.latency);
+			}
+			simulator.finishConfiguration();
+			if (simulator.readTraceFile(traceFileName) == false || simulator.executeProgram() == false)
+			{
+				cout << "Benchmark " << bench.name << " failed" << endl;
+				return false;
+			}
+			result.cycles = simulator.totalNumberOfClockCycles;
+		}
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		if (run == 0 || seconds < result.seconds)
+		{
+			result.seconds = seconds;
+		}
+		result.peakMemory = std::max(result.peakMemory, peakMemory());
+	}
+	result.instructionsPerSecond = result.instructions / result.seconds;
+	result.cyclesPerSecond = result.cycles / result.seconds;
+	return true;
+}
+
+static void printResult(const benchmarkResult& result)
+{
+	cout << result.name << ": " << result.instructions << " instructions, " << result.cycles << " cycles in "
+		<< result.seconds << " s, " << (long long)result.instructionsPerSecond << " instructions/s, "
+		<< (long long)result.cyclesPerSecond << " cycles/s, peak rss " << result.peakMemory << " kB" << endl;
+}
+
+//Decode throughput of one way of decoding a text trace
+struct decodeResult {
+	std::string name;
+	std::string path;
+	unsigned long long bytes = 0;
+	double seconds = 0;
+	double bytesPerSecond = 0;
+};
+
+//Time the decoding of a text trace in memory on one thread, the best of 'repeat' runs. The first path is the reference,
+//the other ones must decode the same instructions
+//returns false if a path does not
+static bool timeDecode(const std::string& name, const std::string& path, const std::string& text, int repeat,
+	const std::function<void(std::vector<decodedInstruction>&)>& decode, std::vector<decodedInstruction>& reference,
+	std::vector<decodeResult>& results)
+{
+	decodeResult result;
+	result.name = name;
+	result.path = path;
+	result.bytes = text.size();
+	std::vector<decodedInstruction> instructions;
+	for (int run = 0; run < repeat; run++)
+	{
+		instructions.clear();
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		decode(instructions);
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		if (run == 0 || seconds < result.seconds)
+		{
+			result.seconds = seconds;
+		}
+	}
+	result.bytesPerSecond = result.bytes / result.seconds;
+	if (reference.empty())
+	{
+		reference = instructions;
+	}
+	else if (instructions.size() != reference.size() ||
+		memcmp(instructions.data(), reference.data(), instructions.size() * sizeof(decodedInstruction)) != 0)
+	{
+		cout << "Benchmark " << name << ": the " << path << " path does not decode the same instructions" << endl;
+		return false;
+	}
+	cout << name << " " << path << ": " << result.bytes << " bytes in " << result.seconds << " s, "
+		<< (long long)result.bytesPerSecond << " bytes/s" << endl;
+	results.push_back(result);
+	return true;
+}
+
+//Decode throughput of the text trace of a benchmark
+/** getline is the way the traces were decoded before parseHexWords(): a std::string per line, std::stoi() and
+	decodeInstruction(). Then decodeTraceText() on one thread with each hex parser the processor supports
+	(see hexparse.h).
+**/
+static bool runDecodeBenchmark(const benchmark& bench, const std::string& traceFileName, int repeat,
+	std::vector<decodeResult>& results)
+{
+	ifstream traceFile(traceFileName, ios::binary);
+	if (!traceFile.is_open())
+	{
+		cout << "Cannot read the corpus trace " << traceFileName << endl;
+		return false;
+	}
+	ostringstream content;
+	content << traceFile.rdbuf();
+	std::string text = content.str();
+	std::vector<decodedInstruction> reference;
+	bool decoded = timeDecode(bench.name, "getline", text, repeat, [&](std::vector<decodedInstruction>& instructions)
+	{
+		istringstream input(text);
+		string line;
+		decodedInstruction currentInstruction;
+		bool error = false;
+		while (getline(input, line))
+		{
+			if (decodeInstruction(line, currentInstruction, error))
+			{
+				instructions.push_back(currentInstruction);
+			}
+		}
+	}, reference, results);
+	for (int parser = 0; parser < NumberOfHexParsers && decoded; parser++)
+	{
+		if (!hexParserSupported((hexParser)parser))
+		{
+			continue;
+		}
+		useHexParser((hexParser)parser);
+		decoded = timeDecode(bench.name, hexParserNames[parser], text, repeat, [&](std::vector<decodedInstruction>& instructions)
+		{
+			decodeTraceText(text.data(), text.size(), 1, instructions);
+		}, reference, results);
+	}
+	useHexParser(fastestHexParser());
+	return decoded;
+}
+
+static bool writeDecodeResults(const std::string& fileName, const std::vector<decodeResult>& results)
+{
+	ofstream resultsFile(fileName);
+	if (!resultsFile.is_open())
+	{
+		cout << "Cannot write the results file";
+		return false;
+	}
+	resultsFile << "#benchmark\tpath\tbytes\tseconds\tbytes/s" << endl;
+	for (const decodeResult& result : results)
+	{
+		resultsFile << result.name << '\t' << result.path << '\t' << result.bytes << '\t' << result.seconds << '\t'
+			<< (long long)result.bytesPerSecond << endl;
+	}
+	return true;
+}
+
+static bool writeResults(const std::string& fileName, const std::vector<benchmarkResult>& results)
+{
+	ofstream resultsFile(fileName);
+	if (!resultsFile.is_open())
+	{
+		cout << "Cannot write the results file";
+		return false;
+	}
+	resultsFile << "#benchmark\tinstructions\tcycles\tseconds\tinstructions/s\tcycles/s\tpeak rss kB" << endl;
+	for (const benchmarkResult& result : results)
+	{
+		resultsFile << result.name << '\t' << result.instructions << '\t' << result.cycles << '\t' << result.seconds << '\t'
+			<< (long long)result.instructionsPerSecond << '\t' << (long long)result.cyclesPerSecond << '\t' << result.peakMemory << endl;
+	}
+	return true;
+}
+
+//Results file of a previous run, by benchmark name
+//returns false if the file cannot be read
+static bool readResults(const std::string& fileName, std::map<std::string, benchmarkResult>& results)
+{
+	string line;
+	ifstream resultsFile(fileName);
+	if (!resultsFile.is_open())
+	{
+		cout << "Cannot read the baseline file";
+		return false;
+	}
+	while (getline(resultsFile, line))
+	{
+		benchmarkResult result;
+		istringstream fields(line);
+		if (line.empty() || line[0] == '#')
+		{
+			continue;
+		}
+		if (!(fields >> result.name >> result.instructions >> result.cycles >> result.seconds >> result.instructionsPerSecond
+			>> result.cyclesPerSecond >> result.peakMemory))
+		{
+			cout << "Invalid line in baseline file: " << line << endl;
+			return false;
+		}
+		results[result.name] = result;
+	}
+	return true;
+}
+
+//Compare with the baseline, a benchmark regresses if its throughput drops or its peak memory grows by more than
+//'tolerance' percent. A different number of cycles means the simulator no longer computes the same thing, the
+//throughputs are not comparable and it is reported as well
+//returns the number of regressions
+static int compareResults(const std::vector<benchmarkResult>& results, const std::map<std::string, benchmarkResult>& baseline,
+	double tolerance)
+{
+	int regressions = 0;
+	cout << "benchmark\tinstructions/s\tbaseline\tchange" << endl;
+	for (const benchmarkResult& result : results)
+	{
+		std::map<std::string, benchmarkResult>::const_iterator previous = baseline.find(result.name);
+		if (previous == baseline.end())
+		{
+			cout << result.name << "\t" << (long long)result.instructionsPerSecond << "\tnot in the baseline" << endl;
+			continue;
+		}
+		const benchmarkResult& base = previous->second;
+		double change = (result.instructionsPerSecond / base.instructionsPerSecond - 1) * 100;
+		cout << result.name << "\t" << (long long)result.instructionsPerSecond << "\t" << (long long)base.instructionsPerSecond
+			<< "\t" << (change >= 0 ? "+" : "") << fixed << setprecision(1) << change << "%" << defaultfloat;
+		if (result.cycles != base.cycles || result.instructions != base.instructions)
+		{
+			cout << "\tREGRESSION: " << result.cycles << " cycles, " << base.cycles << " in the baseline";
+			regressions += 1;
+		}
+		else if (change < -tolerance)
+		{
+			cout << "\tREGRESSION: slower";
+			regressions += 1;
+		}
+		if (result.peakMemory >= 0 && base.peakMemory > 0 && (result.peakMemory - base.peakMemory) * 100.0 > tolerance * base.peakMemory)
+		{
+			cout << "\tREGRESSION: peak rss " << result.peakMemory << " kB, " << base.peakMemory << " kB in the baseline";
+			regressions += 1;
+		}
+		cout << endl;
+	}
+	return regressions;
+}
+
+//Throughput of the simulator on a fixed corpus
+//Each benchmark generates its trace in the corpus directory, then runs it like tomsim does: the text trace is read and
+//decoded while the program executes, so the numbers cover the whole simulation and not only the pipeline. The time is
+//the best of 'repeat' runs. The RS scaling series runs after the corpus. With a baseline (the results file of an
+//earlier run), the exit code is 1 if a benchmark regressed.
+//With --decode, only the decoding of the traces is timed, see runDecodeBenchmark(); there is no baseline then.
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		cout << "Usage: " << argv[0] << " <resultsFile> [--baseline <resultsFile>] [--tolerance <percent>] [--repeat <n>]"
+			" [--corpus <directory>] [--event-driven] [--decode]";
+		return 0;
+	}
+	std::string baselineFileName;
+	std::string corpusDirectory = ".";
+	double tolerance = 10;
+	int repeat = 3;
+	bool eventDriven = false;
+	bool decodeOnly = false;
+	for (int i = 2; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--baseline" && i + 1 < argc)
+		{
+			baselineFileName = argv[++i];
+		}
+		else if (option == "--tolerance" && i + 1 < argc)
+		{
+			tolerance = std::atof(argv[++i]);
+		}
+		else if (option == "--repeat" && i + 1 < argc)
+		{
+			repeat = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (option == "--corpus" && i + 1 < argc)
+		{
+			corpusDirectory = argv[++i];
+		}
+		else if (option == "--event-driven")
+		{
+			eventDriven = true;
+		}
+		else if (option == "--decode")
+		{
+			decodeOnly = true;
+		}
+		else
+		{
+			cout << "Unknown option: " << option << endl;
+			return 0;
+		}
+	}
+	if (decodeOnly)
+	{
+		std::vector<decodeResult> decodeResults;
+		for (const benchmark& bench : corpus)
+		{
+			std::string traceFileName = corpusDirectory + "/bench-" + bench.name + ".t";
+			if (writeCorpusTrace(bench, traceFileName) == false || runDecodeBenchmark(bench, traceFileName, repeat, decodeResults) == false)
+			{
+				return 0;
+			}
+		}
+		writeDecodeResults(argv[1], decodeResults);
+		return 0;
+	}
+	std::map<std::string, benchmarkResult> baseline;
+	if (!baselineFileName.empty() && readResults(baselineFileName, baseline) == false)
+	{
+		return 0;
+	}
+	std::vector<benchmarkResult> results;
+	for (const benchmark& bench : corpus)
+	{
+		std::string traceFileName = corpusDirectory + "/bench-" + bench.name + ".t";
+		if (writeCorpusTrace(bench, traceFileName) == false)
+		{
+			return 0;
+		}
+		benchmarkResult result;
+		if (runBenchmark(bench, traceFileName, repeat, eventDriven, result) == false)
+		{
+			return 0;
+		}
+		printResult(result);
+		results.push_back(result);
+	}
+	//the series shares one trace, the benchmarks only differ by their machine
+	std::string seriesTraceFileName = corpusDirectory + "/bench-" + rsScaling.name + ".t";
+	if (writeCorpusTrace(rsScaling, seriesTraceFileName) == false)
+	{
+		return 0;
+	}
+	for (int stations : rsScalingStations)
+	{
+		std::string name = std::string(rsScaling.name) + "-" + std::to_string(stations);
+		benchmark bench = rsScaling;
+		bench.name = name.c_str();
+		for (int typeFU = 0; typeFU < FUType; typeFU++)
+		{
+			bench.machine[typeFU].numberOfReservationStations = stations;
+		}
+		benchmarkResult result;
+		if (runBenchmark(bench, seriesTraceFileName, repeat, eventDriven, result) == false)
+		{
+			return 0;
+		}
+		printResult(result);
+		results.push_back(result);
+	}
+	if (writeResults(argv[1], results) == false)
+	{
+		return 0;
+	}
+	if (!baseline.empty() && compareResults(results, baseline, tolerance) > 0)
+	{
+		return 1;
+	}
+}
@@ -0,0 +1,99 @@
+#include "iostream"
+#include "fstream"
+#include "string"
+#include "vector"
+#include "cstring"
+
+#include "../tomsim/trace.h"
+#include "../tomsim/decompress.h"
+#include "../tomsim/threadpool.h"
+
+using namespace std;
+
+//Convert a hex text trace (.t), plain or compressed with gzip or zstd, into a binary trace (.tbin)
+//The instructions are decoded exactly like readTraceFile() decodes them, on all the hardware threads, and written
+//block by block
+int main(int argc, char* argv[])
+{
+	if (argc != 3)
+	{
+		cout << "Usage: " << argv[0] << " <traceFile|-> <binaryTraceFile> ";
+		return 0;
+	}
+	ifstream programFile;
+	decompressingStream compressedFile;
+	traceTextReader reader;
+	traceCompression compression = string(argv[1]) != "-" ? compressionOf(argv[1]) : NotCompressed;
+	if (string(argv[1]) == "-")
+	{
+		if (openStandardInput(reader, compressedFile) == false)
+		{
+			return 1;
+		}
+	}
+	else if (compression != NotCompressed)
+	{
+		if (compressedFile.open(argv[1], compression) == false)
+		{
+			return 1;
+		}
+		reader.input = &compressedFile;
+	}
+	else
+	{
+		programFile.open(argv[1]);
+		if (!programFile.is_open())
+		{
+			cout << "Cannot read the input file";
+			return 1;
+		}
+		reader.input = &programFile;
+	}
+	ofstream binaryFile(argv[2], ios::binary | ios::trunc);
+	if (!binaryFile.is_open())
+	{
+		cout << "Cannot write the output file";
+		return 1;
+	}
+
+	//the instruction count is not known yet, the header is written again once the whole trace is converted
+	traceBinaryHeader header;
+	memcpy(header.magic, TraceBinaryMagic, sizeof(header.magic));
+	header.version = TraceBinaryVersion;
+	header.recordSize = sizeof(decodedInstruction);
+	header.instructionCount = 0;
+	header.fingerprint = TraceFingerprintSeed;
+	binaryFile.write((const char*)&header, sizeof(header));
+
+	reader.numberOfThreads = defaultNumberOfThreads();
+	std::vector<decodedInstruction> block;
+	do
+	{
+		if (reader.decodeBlock(block) == false)
+		{
+			return 1;
+		}
+		binaryFile.write((const char*)block.data(), block.size() * sizeof(decodedInstruction));
+		header.instructionCount += block.size();
+		for (const decodedInstruction& inst : block)
+		{
+			header.fingerprint = fingerprintInstruction(header.fingerprint, inst);
+		}
+	} while (!block.empty());
+	if (compressedFile.failed())
+	{
+		cout << "Error: The compressed trace is corrupt or truncated" << endl;
+		return 1;
+	}
+
+	binaryFile.seekp(0);
+	binaryFile.write((const char*)&header, sizeof(header));
+	binaryFile.close();
+	if (!binaryFile)
+	{
+		cout << "Cannot write the output file";
+		return 1;
+	}
+	cout << "Converted " << header.instructionCount << " instructions" << endl;
+	return 0;
+}
@@ -0,0 +1,91 @@
+#include "iostream"
+#include "fstream"
+#include "string"
+#include "cstdlib"
+
+#include "../tomsim/generator.h"
+
+using namespace std;
+
+//Write a synthetic trace, "-" writes it to the standard output so it can be piped into tomsim. The errors go to the
+//standard error and the exit code is 1, so a pipe into tomsim does not read an error message as the trace
+/** tomsim-gen trace.t --length 100000000 --seed 7 --mix integer=4,load=2,store=1 --distance geometric:3
+	tomsim-gen - --length 1000000000 | tomsim - configuration.json output.json --event-driven
+**/
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		cout << "Usage: " << argv[0] << " <traceFile|-> [--length <n>] [--seed <n>] [--mix <fu>=<weight>,...]"
+			" [--opcodes <mnemonic>=<weight>,...] [--dependencies one-way|any] [--dependency <probability>]"
+			" [--distance uniform:<n>|geometric:<n>|fixed:<n>]" << endl;
+		return 0;
+	}
+	traceGeneratorSettings settings;
+	for (int i = 2; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--length" && i + 1 < argc)
+		{
+			settings.length = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (option == "--seed" && i + 1 < argc)
+		{
+			settings.seed = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (option == "--mix" && i + 1 < argc)
+		{
+			if (parseMix(argv[++i], settings) == false)
+			{
+				cerr << "Invalid mix: " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (option == "--opcodes" && i + 1 < argc)
+		{
+			if (parseOpcodeWeights(argv[++i], settings) == false)
+			{
+				cerr << "Invalid opcode weights: " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (option == "--dependencies" && i + 1 < argc)
+		{
+			if (parseDependencyMode(argv[++i], settings.dependencies) == false)
+			{
+				cerr << "Unknown dependency mode: " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (option == "--dependency" && i + 1 < argc)
+		{
+			settings.dependency = std::atof(argv[++i]);
+		}
+		else if (option == "--distance" && i + 1 < argc)
+		{
+			if (parseDistance(argv[++i], settings) == false)
+			{
+				cerr << "Invalid distance: " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else
+		{
+			cerr << "Unknown option: " << option << endl;
+			return 1;
+		}
+	}
+	std::string fileName = argv[1];
+	if (fileName == "-")
+	{
+		std::ios::sync_with_stdio(false);
+		return generateTrace(settings, cout) ? 0 : 1;
+	}
+	ofstream traceFile(fileName, ios::binary);
+	if (!traceFile.is_open())
+	{
+		cerr << "Cannot write the trace file " << fileName << endl;
+		return 1;
+	}
+	return generateTrace(settings, traceFile) ? 0 : 1;
+}
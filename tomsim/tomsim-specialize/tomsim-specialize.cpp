@@ -0,0 +1,81 @@
+#include "iostream"
+#include "fstream"
+#include "sstream"
+#include "string"
+#include "algorithm"
+
+#include "../tomsim/simulator.h"
+
+using namespace std;
+
+//Write the constants of one column of the header: one value per type of FU
+template <typename Value>
+static void writeConstants(ostream& header, const char* name, Value value)
+{
+	header << "constexpr int " << name << "[FUType] = { ";
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		header << value(typeFU) << (typeFU != FUType - 1 ? ", " : " };");
+	}
+	header << endl;
+}
+
+//Write fixedmachine.h, the machine of a simulator built with TOMSIM_FIXED_MACHINE (see simulator.h)
+/** tomsim-specialize configuration.json fixedmachine.h
+	The header is only written if its content changes, so the specialized build is not compiled again for nothing.
+**/
+int main(int argc, char* argv[])
+{
+	if (argc != 3)
+	{
+		cout << "Usage: " << argv[0] << " <configFile> <headerFile>";
+		return 0;
+	}
+	Simulator simulator;
+	if (simulator.readConfigFile(argv[1]) == false)
+	{
+		return 1;
+	}
+	int words = 1;
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		int units = (int)std::max(simulator.FunctionalUnits[typeFU].size(), simulator.ReservationStations[typeFU].size());
+		words = std::max(words, (units + 63) / 64);
+	}
+
+	ostringstream header;
+	header << "#pragma once" << endl << endl;
+	header << "//Generated by tomsim-specialize from " << argv[1] << ", do not edit" << endl;
+	header << "//The machine simulated by a TOMSIM_FIXED_MACHINE build, in the order of functionalUnitNames" << endl;
+	header << "#define FixedMachineName \"";
+	for (const char* c = argv[1]; *c != 0; c++)
+	{
+		//a path of Windows is full of backslashes
+		header << (*c == '\\' || *c == '"' ? "\\" : "") << *c;
+	}
+	header << "\"" << endl;
+	writeConstants(header, "FixedNumberOfUnits", [&](int typeFU) { return simulator.FunctionalUnits[typeFU].size(); });
+	writeConstants(header, "FixedNumberOfReservationStations", [&](int typeFU) { return simulator.ReservationStations[typeFU].size(); });
+	writeConstants(header, "FixedLatency", [&](int typeFU) { return simulator.ClockCycles[typeFU]; });
+	header << "#define FixedFreeListWords " << words << " //64 bit words of the largest free list" << endl;
+
+	ifstream previous(argv[2], ios::binary);
+	if (previous.is_open())
+	{
+		ostringstream content;
+		content << previous.rdbuf();
+		if (content.str() == header.str())
+		{
+			return 0;
+		}
+		previous.close();
+	}
+	ofstream headerFile(argv[2], ios::binary);
+	if (!headerFile.is_open())
+	{
+		cout << "Cannot write the header file";
+		return 1;
+	}
+	headerFile << header.str();
+	return 0;
+}
@@ -0,0 +1,288 @@
+#include "iostream"
+#include "fstream"
+#include "string"
+#include "vector"
+#include "array"
+#include "cstdlib"
+
+#include "../tomsim/simulator.h"
+#include "../tomsim/threadpool.h"
+
+using namespace std;
+
+//Sweep specification, same layout as the configuration file but every field takes several values
+/** {"integer":[{"number":[1,2,4],"resnumber":"2:16:2","latency":2}],
+	"divider":[{"number":1,"resnumber":2,"latency":[4,8]}],
+	...}
+	a field is a number, a list of numbers [a,b,c] or a range "first:last" or "first:last:step"
+	Every combination of the values is simulated.
+**/
+#define SweepFields 3 //number, resnumber, latency
+const char* sweepFieldNames[SweepFields] = { "number", "resnumber", "latency" };
+
+struct sweepSpecification {
+	std::array<bool, FUType> present = {}; //the type of FU appears in the specification
+	std::array<std::array<std::vector<int>, SweepFields>, FUType> values;
+};
+
+struct sweepResult {
+	bool completed = false;
+	long long cycles = 0;
+	long long registerReads = 0;
+	long long stalls = 0;
+};
+
+//Read the values of one field in a line of the specification
+//returns false if the field is missing or malformed
+static bool parseSweepValues(const std::string& line, const std::string& field, std::vector<int>& values)
+{
+	std::string name = "\"" + field + "\":";
+	std::size_t start = line.find(name);
+	if (start == std::string::npos)
+	{
+		cout << "Missing field in sweep file: " << field << endl;
+		return false;
+	}
+	start += name.length();
+	try
+	{
+		if (line[start] == '[')
+		{
+			std::size_t end = line.find(']', start);
+			std::string list = line.substr(start + 1, end - start - 1);
+			std::size_t position = 0;
+			while (position <= list.length())
+			{
+				std::size_t comma = list.find(',', position);
+				if (comma == std::string::npos)
+				{
+					comma = list.length();
+				}
+				values.push_back(std::stoi(list.substr(position, comma - position)));
+				position = comma + 1;
+			}
+		}
+		else if (line[start] == '"')
+		{
+			std::size_t end = line.find('"', start + 1);
+			std::string range = line.substr(start + 1, end - start - 1);
+			std::size_t separator = range.find(':');
+			std::size_t secondSeparator = range.find(':', separator + 1);
+			int first = std::stoi(range.substr(0, separator));
+			int last = std::stoi(range.substr(separator + 1, secondSeparator - separator - 1));
+			int step = (secondSeparator == std::string::npos) ? 1 : std::stoi(range.substr(secondSeparator + 1));
+			if (separator == std::string::npos || step <= 0 || last < first)
+			{
+				cout << "Invalid range in sweep file: " << range << endl;
+				return false;
+			}
+			for (int value = first; value <= last; value += step)
+			{
+				values.push_back(value);
+			}
+		}
+		else
+		{
+			values.push_back(std::stoi(line.substr(start)));
+		}
+	}
+	catch (const std::exception&)
+	{
+		cout << "Invalid value in sweep file for field: " << field << endl;
+		return false;
+	}
+	return true;
+}
+
+//returns true if the sweep file is read properly
+static bool readSweepFile(const std::string& fileName, sweepSpecification& sweep)
+{
+	string line;
+	ifstream sweepFile(fileName);
+	if (!sweepFile.is_open())
+	{
+		cout << "Cannot read the sweep file";
+		return false;
+	}
+	while (getline(sweepFile, line))
+	{
+		if ((line.length() > 0) && line[0] != '#')
+		{
+			std::size_t start = line.find("\"") + 1;
+			std::size_t end = line.find("\":");
+			std::string key = line.substr(start, end - start);
+			int index = -1;
+			for (int typeFU = 0; typeFU < FUType; typeFU++)
+			{
+				if (key == functionalUnitNames[typeFU])
+				{
+					index = typeFU;
+				}
+			}
+			if (index == -1)
+			{
+				cout << "Invalid key in sweep file: " << key << endl;
+				return false;
+			}
+			sweep.present[index] = true;
+			for (int field = 0; field < SweepFields; field++)
+			{
+				sweep.values[index][field].clear();
+				if (parseSweepValues(line.substr(end + 2), sweepFieldNames[field], sweep.values[index][field]) == false)
+				{
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+//Number of configurations of the sweep
+static long long numberOfConfigurations(const sweepSpecification& sweep)
+{
+	long long count = 1;
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		for (int field = 0; sweep.present[typeFU] && field < SweepFields; field++)
+		{
+			count *= sweep.values[typeFU][field].size();
+		}
+	}
+	return count;
+}
+
+//Values of configuration number 'index'. The fields are numbered like the digits of a number, the last field of the
+//last type of FU changes first
+static void getConfiguration(const sweepSpecification& sweep, long long index, std::array<std::array<int, SweepFields>, FUType>& configuration)
+{
+	for (int typeFU = FUType - 1; typeFU >= 0; typeFU--)
+	{
+		for (int field = SweepFields - 1; sweep.present[typeFU] && field >= 0; field--)
+		{
+			const std::vector<int>& values = sweep.values[typeFU][field];
+			configuration[typeFU][field] = values[index % values.size()];
+			index /= values.size();
+		}
+	}
+}
+
+//Simulate one configuration on the shared trace
+static void runConfiguration(const sweepSpecification& sweep, const loadedTrace& trace, long long index, sweepResult& result)
+{
+	std::array<std::array<int, SweepFields>, FUType> configuration;
+	getConfiguration(sweep, index, configuration);
+	Simulator simulator;
+	//a configuration may deadlock, the event driven mode detects it instead of running forever, its statistics are the
+	//same as cycle by cycle
+	simulator.eventDriven = true;
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		if (sweep.present[typeFU])
+		{
+			simulator.addFunctionalUnits(typeFU, configuration[typeFU][0], configuration[typeFU][1], configuration[typeFU][2]);
+		}
+	}
+	simulator.finishConfiguration();
+	simulator.useDecodedTrace(trace.instructions, trace.instructionCount);
+	result.completed = simulator.executeProgram();
+	result.cycles = simulator.totalNumberOfClockCycles;
+	result.registerReads = simulator.numberOfOperandReadFromRegisterFile;
+	result.stalls = simulator.numberOfStructuralHazardStalls;
+}
+
+//One row per configuration, in the order of the configurations
+static bool writeSweepTable(const std::string& fileName, const sweepSpecification& sweep, const std::vector<sweepResult>& results)
+{
+	ofstream table(fileName);
+	if (!table.is_open())
+	{
+		cout << "Cannot create the output file";
+		return false;
+	}
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		for (int field = 0; sweep.present[typeFU] && field < SweepFields; field++)
+		{
+			table << functionalUnitNames[typeFU] << "." << sweepFieldNames[field] << ",";
+		}
+	}
+	table << "cycles,reg reads,stalls,status\n";
+	long long count = results.size();
+	for (long long index = 0; index < count; index++)
+	{
+		std::array<std::array<int, SweepFields>, FUType> configuration;
+		getConfiguration(sweep, index, configuration);
+		for (int typeFU = 0; typeFU < FUType; typeFU++)
+		{
+			for (int field = 0; sweep.present[typeFU] && field < SweepFields; field++)
+			{
+				table << configuration[typeFU][field] << ",";
+			}
+		}
+		const sweepResult& result = results[index];
+		if (result.completed)
+		{
+			table << result.cycles << "," << result.registerReads << "," << result.stalls << ",completed\n";
+		}
+		else
+		{
+			table << ",,,failed\n";
+		}
+	}
+	return true;
+}
+
+//Simulate every configuration of a sweep specification on one trace
+//The trace is decoded once, all the simulations read the same instructions. Each configuration is one job of a work
+//stealing pool, and the results are written to one table once all of them are done.
+int main(int argc, char* argv[])
+{
+	if (argc < 4)
+	{
+		cout << "Usage: " << argv[0] << " <traceFile|-> <sweepFile> <outputTable> [--threads <n>]";
+		return 0;
+	}
+	int numberOfThreads = defaultNumberOfThreads();
+	for (int i = 4; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--threads" && i + 1 < argc)
+		{
+			numberOfThreads = std::atoi(argv[++i]);
+		}
+		else
+		{
+			cout << "Unknown option: " << option << endl;
+			return 0;
+		}
+	}
+	sweepSpecification sweep;
+	if (readSweepFile(argv[2], sweep) == false)
+	{
+		return 0;
+	}
+	long long count = numberOfConfigurations(sweep);
+	if (count > 0x7fffffff)
+	{
+		cout << "Too many configurations in the sweep: " << count << endl;
+		return 0;
+	}
+	loadedTrace trace;
+	if (loadTrace(argv[1], trace, numberOfThreads) == false)
+	{
+		return 0;
+	}
+	std::vector<sweepResult> results(count);
+	std::vector<int> jobs(count);
+	for (int i = 0; i < (int)count; i++)
+	{
+		jobs[i] = i;
+	}
+	runJobs(jobs, numberOfThreads, [&](int index)
+	{
+		runConfiguration(sweep, trace, index, results[index]);
+	});
+	writeSweepTable(argv[3], sweep, results);
+	unloadTrace(trace);
+}
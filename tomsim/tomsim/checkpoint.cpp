@@ -0,0 +1,497 @@
+#include "iostream"
+#include "fstream"
+#include "string"
+#include "vector"
+#include "deque"
+#include "cstring"
+#include "algorithm"
+#include "type_traits"
+
+#include "simulator.h"
+
+using namespace std;
+
+static_assert(std::is_trivially_copyable<instruction>::value, "instruction is stored as a record in the checkpoint");
+static_assert(std::is_trivially_copyable<consumer>::value, "consumer is stored as a record in the checkpoint");
+
+//The fields are written one after the other in the byte order of the machine, like the records of a binary trace
+struct checkpointWriter {
+	ofstream file;
+
+	template <typename T> void put(const T& value)
+	{
+		file.write((const char*)&value, sizeof(T));
+	}
+
+	template <typename T, typename Container> void putAll(const Container& values)
+	{
+		put<unsigned long long>(values.size());
+		for (const T& value : values)
+		{
+			put(value);
+		}
+	}
+
+	//7 bits per byte, the high bit is set on every byte but the last one
+	void putVarint(unsigned long long value)
+	{
+		while (value >= 0x80)
+		{
+			put<unsigned char>((value & 0x7f) | 0x80);
+			value >>= 7;
+		}
+		put<unsigned char>(value);
+	}
+};
+
+//Every read is checked, a truncated or corrupted file only sets 'failed'
+struct checkpointReader {
+	ifstream file;
+	unsigned long long remaining = 0; //bytes left in the file
+	bool failed = false;
+
+	template <typename T> void get(T& value)
+	{
+		if (failed || remaining < sizeof(T) || !file.read((char*)&value, sizeof(T)))
+		{
+			failed = true;
+			return;
+		}
+		remaining -= sizeof(T);
+	}
+
+	template <typename T, typename Container> void getAll(Container& values)
+	{
+		unsigned long long count = 0;
+		get(count);
+		//a corrupted count must not allocate more than the file can hold
+		if (failed || count > remaining / sizeof(T))
+		{
+			failed = true;
+			return;
+		}
+		values.clear();
+		for (unsigned long long i = 0; i < count; i++)
+		{
+			T value;
+			get(value);
+			values.push_back(value);
+		}
+	}
+
+	void getVarint(unsigned long long& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			unsigned char byte = 0;
+			get(byte);
+			value |= (unsigned long long)(byte & 0x7f) << shift;
+			if (failed || (byte & 0x80) == 0)
+			{
+				return;
+			}
+		}
+		failed = true;
+	}
+};
+
+//returns true if every slot number of the list is a slot of the window
+static bool validSlots(const std::vector<int>& slots, int capacity)
+{
+	for (int slot : slots)
+	{
+		if (slot < 0 || slot >= capacity)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//returns true if RS is a reservation station of the type
+static bool validStation(const Simulator& simulator, int typeFU, int RS)
+{
+	return typeFU >= 0 && typeFU < FUType && RS >= 0 && RS < (int)simulator.ReservationStations[typeFU].size();
+}
+
+//returns true if the producer is a reservation station, or [NoProducer, NoProducer]
+static bool validProducer(const Simulator& simulator, const int producer[2])
+{
+	return (producer[0] == NoProducer && producer[1] == NoProducer) || validStation(simulator, producer[0], producer[1]);
+}
+
+//returns true if the free list of 'count' units has no bit set past its last unit and numberOfFree bits set, and every
+//unit of its release order is one of its units. With the LeastRecentlyUsed policy the release order lists exactly the
+//available units
+static bool validFreeList(const freeList& list, int count, allocationPolicy policy)
+{
+	int available = 0;
+	for (int word = 0; word < (int)list.freeUnits.size(); word++)
+	{
+		unsigned long long bits = list.freeUnits[word];
+		int units = std::min(std::max(count - word * 64, 0), 64); //units of the list in this word
+		if (units < 64 && (bits >> units) != 0)
+		{
+			return false;
+		}
+		for (; bits != 0; bits &= bits - 1)
+		{
+			available += 1;
+		}
+	}
+	if (available != list.numberOfFree || list.nextUnit < 0 || list.nextUnit > count)
+	{
+		return false;
+	}
+	if (policy == LeastRecentlyUsed && (int)list.releaseOrder.size() != list.numberOfFree)
+	{
+		return false;
+	}
+	for (int unit : list.releaseOrder)
+	{
+		if (unit < 0 || unit >= count ||
+			(policy == LeastRecentlyUsed && (list.freeUnits[unit / 64] & (1ULL << (unit % 64))) == 0))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//returns true if the stage, the wait code, the decoded instruction and the cycles of an instruction are ones the
+//pipeline makes at the start of clock cycle CC. An executing instruction with more cycles than its latency would never
+//complete
+static bool validInstructionState(const instruction& current, int latency, long long CC)
+{
+	return current.PipelineStage >= Issue && current.PipelineStage <= Wait && current.WaitCode >= -1 &&
+		current.WaitCode <= WaitingForFunctionalUnit && validInstruction(current.inst) &&
+		current.FunctionalUnitType == current.inst.functionalUnitType && current.CCFetched >= 0 && current.CCFetched < CC &&
+		current.CCpassed >= 0 && current.CCpassed <= latency && !(current.PipelineStage == Execute && current.CCpassed == latency);
+}
+
+bool Simulator::writeCheckpoint(const std::string& fileName, long long CC)
+{
+	checkpointWriter writer;
+	writer.file.open(fileName, ios::binary);
+	if (!writer.file.is_open())
+	{
+		cout << "Cannot create the checkpoint file" << endl;
+		return false;
+	}
+	writer.file.write(CheckpointMagic, 8);
+	writer.put<unsigned int>(CheckpointVersion);
+	writer.put<unsigned int>(functionalUnitPolicy);
+	writer.put<long long>(CC);
+	writer.put<unsigned long long>(inputInstructions.fetched);
+	writer.put<unsigned long long>(inputInstructions.fingerprint);
+
+	//configuration, only to check that the checkpoint is restored on the same machine
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		writer.put<unsigned int>(ReservationStations[typeFU].size());
+		writer.put<unsigned int>(FunctionalUnits[typeFU].size());
+		writer.put<int>(ClockCycles[typeFU]);
+	}
+
+	writer.put(numberOfStructuralHazardStalls);
+	writer.put(numberOfOperandReadFromRegisterFile);
+	writer.put(registers);
+	writer.put(registerResultStatus);
+
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		for (const reservationStation& r : ReservationStations[typeFU])
+		{
+			writer.put(r.busy);
+			writer.put(r.source1Ready);
+			writer.put(r.source2Ready);
+			writer.put(r.source1Value);
+			writer.put(r.source2Value);
+			writer.put(r.source1Producer);
+			writer.put(r.source2Producer);
+			writer.put(r.destination);
+			writer.put(r.ownedRegisters);
+			writer.putAll<consumer>(r.consumers);
+		}
+		for (const functionalUnit& f : FunctionalUnits[typeFU])
+		{
+			writer.put(f.busy);
+			writer.put(f.reservationStationNumber);
+			writer.put(f.numberOfInstructionsExecuted);
+		}
+	}
+
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		for (const freeList* list : { &freeReservationStations[typeFU], &freeFunctionalUnits[typeFU] })
+		{
+			writer.putAll<unsigned long long>(list->freeUnits);
+			writer.put(list->numberOfFree);
+			writer.put(list->nextUnit);
+			writer.putAll<int>(list->releaseOrder);
+		}
+	}
+
+	writer.putAll<instruction>(activeInstructions.slots);
+	writer.putAll<unsigned char>(activeInstructions.inUse);
+	writer.putAll<int>(activeInstructions.freeSlots);
+	std::vector<int> order;
+	collectAgeOrder(order); //the file lists the waiting instructions in 'order' as well
+	writer.putAll<int>(order);
+	writer.put(activeInstructions.size);
+
+	//On a long trace the issue queues can hold millions of instructions. A waiting instruction is stored as its trace
+	//record and the number of cycles since the previous instruction of the queue was fetched. Its expected outcome is
+	//not stored, the check mode does not run from a checkpoint
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		writer.put<unsigned long long>(issueQueues[typeFU].size());
+		long long previousFetch = 0;
+		for (const queuedInstruction& waiting : issueQueues[typeFU])
+		{
+			writer.put(waiting.inst);
+			writer.putVarint((unsigned long long)(waiting.CCFetched - previousFetch));
+			previousFetch = waiting.CCFetched;
+		}
+	}
+
+	writer.file.close();
+	if (!writer.file)
+	{
+		cout << "Cannot write the checkpoint file" << endl;
+		return false;
+	}
+	LOG(LogInfo, CC) << "Checkpoint written at clock cycle " << CC << ", " << inputInstructions.fetched << " instructions fetched" << '\n';
+	return true;
+}
+
+bool Simulator::restoreCheckpoint(const std::string& fileName)
+{
+	checkpointReader reader;
+	reader.file.open(fileName, ios::binary);
+	if (!reader.file.is_open())
+	{
+		cout << "Cannot read the checkpoint file" << endl;
+		return false;
+	}
+	reader.file.seekg(0, ios::end);
+	reader.remaining = reader.file.tellg();
+	reader.file.seekg(0, ios::beg);
+
+	char magic[8];
+	unsigned int version = 0;
+	unsigned int policy = 0;
+	long long CC = 0;
+	unsigned long long fetched = 0;
+	unsigned long long fingerprint = 0;
+	reader.get(magic);
+	reader.get(version);
+	reader.get(policy);
+	reader.get(CC);
+	reader.get(fetched);
+	reader.get(fingerprint);
+	if (reader.failed || memcmp(magic, CheckpointMagic, sizeof(magic)) != 0)
+	{
+		cout << "Error: Not a checkpoint file" << endl;
+		return false;
+	}
+	if (version != CheckpointVersion)
+	{
+		cout << "Error: Unsupported checkpoint version " << version << endl;
+		return false;
+	}
+	if (policy != (unsigned int)functionalUnitPolicy)
+	{
+		cout << "Error: The checkpoint was taken with another allocation policy" << endl;
+		return false;
+	}
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		unsigned int numberOfReservationStations = 0;
+		unsigned int numberOfUnits = 0;
+		int latency = 0;
+		reader.get(numberOfReservationStations);
+		reader.get(numberOfUnits);
+		reader.get(latency);
+		if (numberOfReservationStations != ReservationStations[typeFU].size() || numberOfUnits != FunctionalUnits[typeFU].size() ||
+			latency != ClockCycles[typeFU])
+		{
+			cout << "Error: The checkpoint was taken with another configuration" << endl;
+			return false;
+		}
+	}
+
+	reader.get(numberOfStructuralHazardStalls);
+	reader.get(numberOfOperandReadFromRegisterFile);
+	reader.get(registers);
+	reader.get(registerResultStatus);
+	for (const std::array<int, 2>& producer : registerResultStatus)
+	{
+		if (!validProducer(*this, producer.data()))
+		{
+			reader.failed = true;
+		}
+	}
+
+	//the tags and indices are checked as they are read, the pipeline uses them to index its tables
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		for (reservationStation& r : ReservationStations[typeFU])
+		{
+			reader.get(r.busy);
+			reader.get(r.source1Ready);
+			reader.get(r.source2Ready);
+			reader.get(r.source1Value);
+			reader.get(r.source2Value);
+			reader.get(r.source1Producer);
+			reader.get(r.source2Producer);
+			reader.get(r.destination);
+			reader.get(r.ownedRegisters);
+			reader.getAll<consumer>(r.consumers);
+			//the destination is set in the read stage, before it the station keeps the one of its previous instruction
+			if (!validProducer(*this, r.source1Producer) || !validProducer(*this, r.source2Producer) ||
+				!validProducer(*this, r.destination))
+			{
+				reader.failed = true;
+			}
+			for (const consumer& waiting : r.consumers)
+			{
+				if (!validStation(*this, waiting.typeFU, waiting.RS) || (waiting.source != 1 && waiting.source != 2))
+				{
+					reader.failed = true;
+				}
+			}
+		}
+		for (functionalUnit& f : FunctionalUnits[typeFU])
+		{
+			reader.get(f.busy);
+			reader.get(f.reservationStationNumber);
+			reader.get(f.numberOfInstructionsExecuted);
+			if (f.busy && !validStation(*this, typeFU, f.reservationStationNumber))
+			{
+				reader.failed = true;
+			}
+		}
+	}
+
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		//the reservation stations are always allocated lowest index first
+		int counts[2] = { (int)ReservationStations[typeFU].size(), (int)FunctionalUnits[typeFU].size() };
+		freeList* lists[2] = { &freeReservationStations[typeFU], &freeFunctionalUnits[typeFU] };
+		allocationPolicy policies[2] = { LowestIndex, functionalUnitPolicy };
+		for (int l = 0; l < 2; l++)
+		{
+			freeList* list = lists[l];
+			std::size_t words = list->freeUnits.size();
+			reader.getAll<unsigned long long>(list->freeUnits);
+			reader.get(list->numberOfFree);
+			reader.get(list->nextUnit);
+			reader.getAll<int>(list->releaseOrder);
+			if (list->freeUnits.size() != words || !validFreeList(*list, counts[l], policies[l]))
+			{
+				reader.failed = true;
+				continue;
+			}
+			//a unit is available exactly when it is not busy
+			for (int unit = 0; unit < counts[l]; unit++)
+			{
+				bool available = (list->freeUnits[unit / 64] & (1ULL << (unit % 64))) != 0;
+				bool busy = l == 0 ? ReservationStations[typeFU][unit].busy : FunctionalUnits[typeFU][unit].busy;
+				if (available == busy)
+				{
+					reader.failed = true;
+				}
+			}
+		}
+	}
+
+	int capacity = activeInstructions.slots.size();
+	reader.getAll<instruction>(activeInstructions.slots);
+	reader.getAll<unsigned char>(activeInstructions.inUse);
+	reader.getAll<int>(activeInstructions.freeSlots);
+	reader.getAll<int>(activeInstructions.order);
+	reader.get(activeInstructions.size);
+	if ((int)activeInstructions.slots.size() != capacity || (int)activeInstructions.inUse.size() != capacity ||
+		!validSlots(activeInstructions.freeSlots, capacity) || !validSlots(activeInstructions.order, capacity) ||
+		activeInstructions.size < 0 || activeInstructions.size > capacity)
+	{
+		reader.failed = true;
+	}
+	for (int i = 0; i < (int)activeInstructions.inUse.size() && !reader.failed; i++)
+	{
+		const instruction& active = activeInstructions.slots[i];
+		int typeFU = active.FunctionalUnitType;
+		if (activeInstructions.inUse[i] > 1 || (activeInstructions.inUse[i] == 1 &&
+			(!validStation(*this, typeFU, active.ReservationStation) || !validInstructionState(active, latency(typeFU), CC) ||
+			active.FunctionalUnit < -1 || active.FunctionalUnit >= (int)FunctionalUnits[typeFU].size())))
+		{
+			reader.failed = true;
+		}
+	}
+
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		unsigned long long count = 0;
+		reader.get(count);
+		issueQueues[typeFU].clear();
+		long long previousFetch = 0;
+		for (unsigned long long i = 0; i < count && !reader.failed; i++)
+		{
+			queuedInstruction waiting;
+			unsigned long long distance = 0;
+			reader.get(waiting.inst);
+			reader.getVarint(distance);
+			waiting.CCFetched = previousFetch + (long long)distance;
+			previousFetch = waiting.CCFetched;
+			if (!validInstruction(waiting.inst) || waiting.inst.functionalUnitType != typeFU || waiting.CCFetched < 0 ||
+				waiting.CCFetched >= CC)
+			{
+				reader.failed = true;
+			}
+			issueQueues[typeFU].push_back(waiting);
+		}
+	}
+	if (reader.failed || reader.remaining != 0)
+	{
+		cout << "Error: The checkpoint file is corrupted" << endl;
+		return false;
+	}
+	parkWaitingInstructions();
+
+	//The trace goes on with the first instruction not fetched yet, the instructions skipped must be the ones the
+	//checkpoint was taken with
+	inputInstructions.fingerprinted = true;
+	decodedInstruction skipped;
+	bool available = true;
+	while (inputInstructions.fetched < fetched && available)
+	{
+		if (inputInstructions.binary.instructions != nullptr)
+		{
+			available = fetched <= inputInstructions.binary.instructionCount;
+			for (; available && inputInstructions.fetched < fetched; inputInstructions.fetched++)
+			{
+				inputInstructions.fingerprint = fingerprintInstruction(inputInstructions.fingerprint,
+					inputInstructions.binary.instructions[inputInstructions.fetched]);
+			}
+		}
+		else if (fetchInstruction(skipped, available) == false)
+		{
+			cout << "Some problem in reading the trace. Aborting the execution.";
+			return false;
+		}
+	}
+	if (available == false)
+	{
+		cout << "Error: The trace is shorter than the checkpoint" << endl;
+		return false;
+	}
+	if (inputInstructions.fingerprint != fingerprint)
+	{
+		cout << "Error: The checkpoint was taken with another trace" << endl;
+		return false;
+	}
+	firstCycle = CC;
+	return true;
+}
@@ -0,0 +1,280 @@
+#include "iostream"
+#include "sstream"
+#include "iomanip"
+#include "cstring"
+#include "cstdlib"
+#include "cstdio"
+#include "algorithm"
+#include "thread"
+#include "functional"
+
+#ifdef _WIN32
+#include "windows.h"
+#include "process.h"
+#else
+#include "sys/stat.h"
+#include "sys/types.h"
+#include "dirent.h"
+#include "unistd.h"
+#include "utime.h"
+#endif
+
+#include "decodecache.h"
+
+using namespace std;
+
+#define HashReadSize (1024 * 1024) //bytes of the trace file hashed at once, a multiple of 8
+
+//An entry of the cache directory
+struct cacheEntry {
+	std::string fileName;
+	unsigned long long size;
+	long long lastUse; //modification time, only compared with the other entries
+};
+
+//Hash of the content of a file, two 64 bit lanes over its 8 byte words. It is not a cryptographic hash, the size of the
+//file is part of the entry name as well
+static bool hashFile(const std::string& fileName, unsigned long long lanes[2], unsigned long long& size)
+{
+	ifstream traceFile(fileName, ios::binary);
+	if (!traceFile.is_open())
+	{
+		return false;
+	}
+	std::vector<char> buffer(HashReadSize);
+	lanes[0] = 0xcbf29ce484222325ULL;
+	lanes[1] = 0x9e3779b97f4a7c15ULL;
+	size = 0;
+	while (traceFile.read(buffer.data(), buffer.size()), traceFile.gcount() > 0)
+	{
+		std::size_t count = (std::size_t)traceFile.gcount();
+		//the last word of the file is padded with zeros
+		std::fill(buffer.begin() + count, buffer.begin() + ((count + 7) & ~(std::size_t)7), 0);
+		for (std::size_t i = 0; i < count; i += 8)
+		{
+			unsigned long long word;
+			memcpy(&word, buffer.data() + i, sizeof(word));
+			lanes[0] = (lanes[0] ^ word) * 0x100000001b3ULL;
+			lanes[1] = lanes[1] + word * 0xc2b2ae3d27d4eb4fULL;
+			lanes[1] = ((lanes[1] << 31) | (lanes[1] >> 33)) * 0x9e3779b97f4a7c15ULL;
+		}
+		size += count;
+	}
+	return true;
+}
+
+static std::string cacheDirectory(const decodeCacheSettings& settings)
+{
+	if (!settings.directory.empty())
+	{
+		return settings.directory;
+	}
+	const char* directory = std::getenv("TOMSIM_DECODE_CACHE");
+	if (directory != nullptr && directory[0] != 0)
+	{
+		return directory;
+	}
+#ifdef _WIN32
+	char temporary[MAX_PATH + 1];
+	DWORD length = GetTempPathA(sizeof(temporary), temporary);
+	std::string base = length > 0 && length <= MAX_PATH ? std::string(temporary, length) : std::string(".\\");
+#else
+	const char* temporary = std::getenv("TMPDIR");
+	std::string base = std::string(temporary != nullptr && temporary[0] != 0 ? temporary : "/tmp") + "/";
+#endif
+	return base + "tomsim-decode-cache";
+}
+
+bool findDecodeCacheEntry(const decodeCacheSettings& settings, const std::string& traceFileName, std::string& entryFileName)
+{
+	unsigned long long lanes[2] = { 0, 0 };
+	unsigned long long size = 0;
+	if (hashFile(traceFileName, lanes, size) == false)
+	{
+		return false;
+	}
+	ostringstream name;
+	name << cacheDirectory(settings) << "/" << hex << setfill('0') << setw(16) << lanes[0] << setw(16) << lanes[1]
+		<< dec << "-" << size << "-v" << DecodeCacheVersion << ".tbin";
+	entryFileName = name.str();
+	return true;
+}
+
+void removeDecodeCacheEntry(const std::string& entryFileName)
+{
+	std::remove(entryFileName.c_str());
+}
+
+#ifdef _WIN32
+
+bool useDecodeCacheEntry(const std::string& entryFileName)
+{
+	HANDLE file = CreateFileA(entryFileName.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+	SetFileTime(file, NULL, NULL, &now);
+	CloseHandle(file);
+	return true;
+}
+
+static void makeDirectory(const std::string& directory)
+{
+	CreateDirectoryA(directory.c_str(), NULL);
+}
+
+static std::vector<cacheEntry> listEntries(const std::string& directory)
+{
+	std::vector<cacheEntry> entries;
+	WIN32_FIND_DATAA found;
+	HANDLE search = FindFirstFileA((directory + "\\*.tbin").c_str(), &found);
+	if (search == INVALID_HANDLE_VALUE)
+	{
+		return entries;
+	}
+	do
+	{
+		cacheEntry entry;
+		entry.fileName = directory + "/" + found.cFileName;
+		entry.size = ((unsigned long long)found.nFileSizeHigh << 32) | found.nFileSizeLow;
+		entry.lastUse = ((long long)found.ftLastWriteTime.dwHighDateTime << 32) | found.ftLastWriteTime.dwLowDateTime;
+		entries.push_back(entry);
+	} while (FindNextFileA(search, &found));
+	FindClose(search);
+	return entries;
+}
+
+static int processId()
+{
+	return _getpid();
+}
+
+#else
+
+bool useDecodeCacheEntry(const std::string& entryFileName)
+{
+	return utime(entryFileName.c_str(), nullptr) == 0;
+}
+
+static void makeDirectory(const std::string& directory)
+{
+	mkdir(directory.c_str(), 0777);
+}
+
+static std::vector<cacheEntry> listEntries(const std::string& directory)
+{
+	std::vector<cacheEntry> entries;
+	DIR* listing = opendir(directory.c_str());
+	if (listing == nullptr)
+	{
+		return entries;
+	}
+	while (dirent* found = readdir(listing))
+	{
+		std::string name = found->d_name;
+		struct stat status;
+		if (name.size() < 5 || name.compare(name.size() - 5, 5, ".tbin") != 0 ||
+			stat((directory + "/" + name).c_str(), &status) != 0)
+		{
+			continue;
+		}
+		cacheEntry entry;
+		entry.fileName = directory + "/" + name;
+		entry.size = status.st_size;
+		entry.lastUse = (long long)status.st_mtime;
+		entries.push_back(entry);
+	}
+	closedir(listing);
+	return entries;
+}
+
+static int processId()
+{
+	return getpid();
+}
+
+#endif
+
+bool decodeCacheWriter::open(const decodeCacheSettings& settings, const std::string& entryFileName)
+{
+	discard();
+	directory = cacheDirectory(settings);
+	makeDirectory(directory);
+	this->entryFileName = entryFileName;
+	//several simulations of the same trace can write its entry at the same time, each one in its own file
+	temporaryFileName = entryFileName + "." + std::to_string(processId()) + "-" +
+		std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	sizeLimit = settings.sizeLimit;
+	file.open(temporaryFileName, ios::binary | ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	memcpy(header.magic, TraceBinaryMagic, sizeof(header.magic));
+	header.version = TraceBinaryVersion;
+	header.recordSize = sizeof(decodedInstruction);
+	header.instructionCount = 0;
+	header.fingerprint = TraceFingerprintSeed;
+	file.write((const char*)&header, sizeof(header));
+	return true;
+}
+
+void decodeCacheWriter::add(const decodedInstruction* instructions, std::size_t count)
+{
+	file.write((const char*)instructions, count * sizeof(decodedInstruction));
+	header.instructionCount += count;
+	for (std::size_t i = 0; i < count; i++)
+	{
+		header.fingerprint = fingerprintInstruction(header.fingerprint, instructions[i]);
+	}
+}
+
+void decodeCacheWriter::commit()
+{
+	if (!file.is_open())
+	{
+		return;
+	}
+	file.seekp(0);
+	file.write((const char*)&header, sizeof(header));
+	file.close();
+	if (!file)
+	{
+		//the disk is full, the entry is not complete
+		std::remove(temporaryFileName.c_str());
+		return;
+	}
+	if (std::rename(temporaryFileName.c_str(), entryFileName.c_str()) != 0)
+	{
+		//another simulation added the same entry first
+		std::remove(temporaryFileName.c_str());
+	}
+
+	//least recently used first
+	std::vector<cacheEntry> entries = listEntries(directory);
+	std::sort(entries.begin(), entries.end(), [](const cacheEntry& a, const cacheEntry& b) { return a.lastUse < b.lastUse; });
+	unsigned long long total = 0;
+	for (const cacheEntry& entry : entries)
+	{
+		total += entry.size;
+	}
+	for (std::size_t i = 0; i < entries.size() && total > sizeLimit; i++)
+	{
+		std::remove(entries[i].fileName.c_str());
+		total -= entries[i].size;
+	}
+}
+
+void decodeCacheWriter::discard()
+{
+	if (!file.is_open())
+	{
+		return;
+	}
+	file.close();
+	std::remove(temporaryFileName.c_str());
+}
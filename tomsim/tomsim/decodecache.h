@@ -0,0 +1,67 @@
+#pragma once
+
+#include "string"
+#include "vector"
+#include "fstream"
+
+#include "trace.h"
+
+//Decode cache
+/** Every run of a text trace decodes it again. The decode cache keeps the decoded instructions of the text traces already
+	run as binary traces (see trace.h), named after the content of the trace file:
+		<directory>/<hash of the trace file, 32 hex digits>-<size of the trace file>-v<DecodeCacheVersion>.tbin
+	The first run of a trace writes its entry while it decodes the trace, the next runs map the entry instead of decoding
+	the trace. A trace changed in place has another hash, so it gets another entry. An entry is written in a temporary
+	file and renamed once the whole trace is decoded. Mapping an entry checks every one of its records and their
+	fingerprint like any binary trace (see mapBinaryTrace()); an entry which cannot be mapped, holds an invalid record or
+	whose records were changed is removed and the trace is decoded.
+	The cache holds at most sizeLimit bytes. Using an entry sets its modification time, once an entry is added the ones
+	used the longest time ago are removed until the cache fits.
+	The directory is TOMSIM_DECODE_CACHE if it is set, else tomsim-decode-cache in the temporary directory.
+**/
+#define DecodeCacheVersion 2 //change it when decodeInstruction() decodes a line differently or the binary trace format
+//changes, the old entries are not used
+#define DefaultDecodeCacheSize (2048ULL * 1024 * 1024) //bytes
+
+struct decodeCacheSettings {
+	bool enabled = true;
+	std::string directory; //empty for the default directory
+	unsigned long long sizeLimit = DefaultDecodeCacheSize; //bytes
+};
+
+//Name of the entry of a trace file in the cache, the whole file is read to hash it
+//returns false if the file cannot be read
+bool findDecodeCacheEntry(const decodeCacheSettings& settings, const std::string& traceFileName, std::string& entryFileName);
+
+//returns true if the entry is in the cache, it becomes the most recently used one
+bool useDecodeCacheEntry(const std::string& entryFileName);
+
+void removeDecodeCacheEntry(const std::string& entryFileName);
+
+//Write the entry of a trace while the trace is decoded
+class decodeCacheWriter {
+public:
+	~decodeCacheWriter() { discard(); }
+
+	//returns false if the entry cannot be written, the trace is then simply not cached
+	bool open(const decodeCacheSettings& settings, const std::string& entryFileName);
+	bool isOpen() const { return file.is_open(); }
+
+	//Write the next instructions of the trace
+	void add(const decodedInstruction* instructions, std::size_t count);
+
+	//The whole trace is decoded: the entry is added to the cache, and the least recently used entries are removed if
+	//the cache is over its size
+	void commit();
+
+	//The trace is not decoded to its end, the entry is dropped
+	void discard();
+
+private:
+	std::ofstream file;
+	std::string entryFileName;
+	std::string temporaryFileName;
+	std::string directory;
+	unsigned long long sizeLimit = 0;
+	traceBinaryHeader header;
+};
@@ -0,0 +1,359 @@
+#include "iostream"
+#include "cstring"
+#include "chrono"
+#include "algorithm"
+
+#if TOMSIM_ZLIB
+#include "zlib.h"
+#endif
+#if TOMSIM_ZSTD
+#include "zstd.h"
+#endif
+
+#include "decompress.h"
+
+using namespace std;
+
+#define CompressedReadSize (256 * 1024) //bytes of the compressed file read at once
+
+traceCompression compressionOf(const std::string& fileName)
+{
+	unsigned char magic[4] = {};
+	ifstream traceFile(fileName, ios::binary);
+	traceFile.read((char*)magic, sizeof(magic));
+	return compressionOf(magic, (std::size_t)traceFile.gcount());
+}
+
+traceCompression compressionOf(const unsigned char* magic, std::size_t size)
+{
+	if (size >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+	{
+		return GzipCompressed;
+	}
+	if (size >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+	{
+		return ZstdCompressed;
+	}
+	return NotCompressed;
+}
+
+//Wait a little for the other side of the ring. It is usually a short wait for the decompression thread to finish a block,
+//the thread gives up its time slice. A long wait is the decompression thread waiting for the simulator to read a block,
+//which takes milliseconds; the thread sleeps instead of spinning on a core for the whole simulation
+static void backOff(int& attempts)
+{
+	attempts += 1;
+	if (attempts < 64)
+	{
+		std::this_thread::yield();
+	}
+	else
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+	}
+}
+
+decompressingBuffer::~decompressingBuffer()
+{
+	close();
+}
+
+//returns false, with a message, if this build cannot decompress the format
+bool decompressingBuffer::supported(traceCompression compression, const std::string& name) const
+{
+	if ((compression == GzipCompressed && !TOMSIM_ZLIB) || (compression == ZstdCompressed && !TOMSIM_ZSTD))
+	{
+		cout << "Error: This simulator is built without " << (compression == GzipCompressed ? "zlib" : "libzstd")
+			<< ", it cannot read the compressed trace " << name << endl;
+		return false;
+	}
+	return true;
+}
+
+void decompressingBuffer::startProducer(traceCompression compression)
+{
+	this->compression = compression;
+	for (block& current : blocks)
+	{
+		current.text.resize(DecompressedBlockSize);
+	}
+	producer = std::thread(&decompressingBuffer::decompress, this);
+}
+
+bool decompressingBuffer::open(const std::string& fileName, traceCompression compression)
+{
+	close();
+	if (supported(compression, fileName) == false)
+	{
+		return false;
+	}
+	file.open(fileName, ios::binary);
+	if (!file.is_open())
+	{
+		cout << "Cannot read the input file";
+		return false;
+	}
+	source = &file;
+	startProducer(compression);
+	return true;
+}
+
+//Only the decompression thread reads the standard input until the stream is closed
+bool decompressingBuffer::openStandardInput(const std::string& start, traceCompression compression)
+{
+	close();
+	if (supported(compression, "on the standard input") == false)
+	{
+		return false;
+	}
+	source = &cin;
+	this->start = start;
+	startProducer(compression);
+	return true;
+}
+
+void decompressingBuffer::close()
+{
+	if (producer.joinable())
+	{
+		stopping.store(true, std::memory_order_relaxed);
+		producer.join();
+	}
+	if (file.is_open())
+	{
+		file.close();
+	}
+	source = nullptr;
+	start.clear();
+	head.store(0, std::memory_order_relaxed);
+	tail.store(0, std::memory_order_relaxed);
+	finished.store(false, std::memory_order_relaxed);
+	corrupt.store(false, std::memory_order_relaxed);
+	stopping.store(false, std::memory_order_relaxed);
+	reading = false;
+	filled = 0;
+	setg(nullptr, nullptr, nullptr);
+}
+
+//Next block of text for the reader, the block it has read is given back to the decompression thread
+decompressingBuffer::int_type decompressingBuffer::underflow()
+{
+	unsigned long long index = head.load(std::memory_order_relaxed);
+	if (reading)
+	{
+		reading = false;
+		index += 1;
+		head.store(index, std::memory_order_release);
+	}
+	int attempts = 0;
+	while (index == tail.load(std::memory_order_acquire))
+	{
+		//the last block is added before 'finished' is set, so the ring is checked again once it is set
+		if (finished.load(std::memory_order_acquire) && index == tail.load(std::memory_order_acquire))
+		{
+			setg(nullptr, nullptr, nullptr);
+			return traits_type::eof();
+		}
+		backOff(attempts);
+	}
+	block& current = blocks[index % DecompressedBlocks];
+	setg(current.text.data(), current.text.data(), current.text.data() + current.size);
+	reading = true;
+	return traits_type::to_int_type(*gptr());
+}
+
+//Read the next compressed bytes, the bytes read before the decompression started come first
+//returns the number of bytes read, 0 at the end of the source
+std::size_t decompressingBuffer::readCompressed(char* data, std::size_t size)
+{
+	std::size_t count = std::min(size, start.size());
+	memcpy(data, start.data(), count);
+	start.erase(0, count);
+	if (count < size)
+	{
+		source->read(data + count, size - count);
+		count += (std::size_t)source->gcount();
+	}
+	return count;
+}
+
+//Body of the decompression thread
+void decompressingBuffer::decompress()
+{
+	bool complete = compression == GzipCompressed ? decompressGzip() : decompressZstd();
+	publishBlock();
+	if (complete == false && stopping.load(std::memory_order_relaxed) == false)
+	{
+		corrupt.store(true, std::memory_order_release);
+	}
+	finished.store(true, std::memory_order_release);
+}
+
+//Space left in the block being filled. A new block is only used once the reader has given it back
+//returns nullptr if the reader closed the stream
+char* decompressingBuffer::freeSpace(std::size_t& space)
+{
+	unsigned long long index = tail.load(std::memory_order_relaxed);
+	if (filled == 0)
+	{
+		int attempts = 0;
+		while (index - head.load(std::memory_order_acquire) >= DecompressedBlocks)
+		{
+			if (stopping.load(std::memory_order_relaxed))
+			{
+				return nullptr;
+			}
+			backOff(attempts);
+		}
+	}
+	if (stopping.load(std::memory_order_relaxed))
+	{
+		return nullptr;
+	}
+	space = DecompressedBlockSize - filled;
+	return blocks[index % DecompressedBlocks].text.data() + filled;
+}
+
+//Count the text written in the free space, a full block goes to the reader
+void decompressingBuffer::addText(std::size_t size)
+{
+	filled += size;
+	if (filled == DecompressedBlockSize)
+	{
+		publishBlock();
+	}
+}
+
+void decompressingBuffer::publishBlock()
+{
+	if (filled == 0)
+	{
+		return;
+	}
+	unsigned long long index = tail.load(std::memory_order_relaxed);
+	blocks[index % DecompressedBlocks].size = filled;
+	filled = 0;
+	tail.store(index + 1, std::memory_order_release);
+}
+
+//returns false if the file is not a complete gzip file. A file made of several gzip members is read as one text
+bool decompressingBuffer::decompressGzip()
+{
+#if TOMSIM_ZLIB
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+	{
+		return false;
+	}
+	std::vector<char> input(CompressedReadSize);
+	bool complete = false;
+	while (std::size_t count = readCompressed(input.data(), input.size()))
+	{
+		stream.next_in = (Bytef*)input.data();
+		stream.avail_in = (uInt)count;
+		//go on while there is input, or output zlib could not write in a full block
+		do
+		{
+			std::size_t space;
+			char* text = freeSpace(space);
+			if (text == nullptr)
+			{
+				inflateEnd(&stream);
+				return true;
+			}
+			stream.next_out = (Bytef*)text;
+			stream.avail_out = (uInt)space;
+			int status = inflate(&stream, Z_NO_FLUSH);
+			if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR)
+			{
+				inflateEnd(&stream);
+				return false;
+			}
+			addText(space - stream.avail_out);
+			if (status == Z_STREAM_END)
+			{
+				complete = true;
+				inflateReset(&stream); //the next member, if there is one
+			}
+			else if (status == Z_OK)
+			{
+				complete = false;
+			}
+			else
+			{
+				break; //no progress, more input is needed
+			}
+		} while (stream.avail_in > 0 || stream.avail_out == 0);
+	}
+	inflateEnd(&stream);
+	return complete;
+#else
+	return false;
+#endif
+}
+
+//returns false if the file is not a complete zstd file. Concatenated frames are read as one text
+bool decompressingBuffer::decompressZstd()
+{
+#if TOMSIM_ZSTD
+	ZSTD_DStream* stream = ZSTD_createDStream();
+	if (stream == nullptr || ZSTD_isError(ZSTD_initDStream(stream)))
+	{
+		ZSTD_freeDStream(stream);
+		return false;
+	}
+	std::vector<char> input(CompressedReadSize);
+	bool complete = false;
+	while (std::size_t count = readCompressed(input.data(), input.size()))
+	{
+		ZSTD_inBuffer in = { input.data(), count, 0 };
+		bool full = false;
+		//go on while there is input, or output zstd could not write in a full block
+		while (in.pos < in.size || full)
+		{
+			std::size_t space;
+			char* text = freeSpace(space);
+			if (text == nullptr)
+			{
+				ZSTD_freeDStream(stream);
+				return true;
+			}
+			ZSTD_outBuffer out = { text, space, 0 };
+			std::size_t consumed = in.pos;
+			std::size_t status = ZSTD_decompressStream(stream, &out, &in);
+			if (ZSTD_isError(status))
+			{
+				ZSTD_freeDStream(stream);
+				return false;
+			}
+			addText(out.pos);
+			if (status == 0)
+			{
+				complete = true; //end of a frame
+			}
+			else if (in.pos != consumed || out.pos > 0)
+			{
+				complete = false;
+			}
+			full = out.pos == out.size;
+		}
+	}
+	ZSTD_freeDStream(stream);
+	return complete;
+#else
+	return false;
+#endif
+}
+
+bool decompressingStream::open(const std::string& fileName, traceCompression compression)
+{
+	clear();
+	return buffer.open(fileName, compression);
+}
+
+bool decompressingStream::openStandardInput(const std::string& start, traceCompression compression)
+{
+	clear();
+	return buffer.openStandardInput(start, compression);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "istream"
+#include "fstream"
+#include "string"
+#include "vector"
+#include "thread"
+#include "atomic"
+
+//Compressed text traces
+/** A text trace compressed with gzip or zstd is recognized by its magic bytes and read like the plain text: a
+	decompressingStream is an istream of the decompressed text, so the lines go through decodeInstruction() as they do
+	for an uncompressed trace.
+	The decompression runs on a thread of its own. It fills blocks of text and hands them to the reader through a ring of
+	DecompressedBlocks blocks with one producer and one consumer, so the next blocks are decompressed while the current
+	one is decoded and simulated. No lock is taken, a side only waits when the ring is full or empty.
+	gzip needs zlib (build with TOMSIM_ZLIB=1 and link zlib), zstd needs libzstd (TOMSIM_ZSTD=1, link libzstd). A
+	simulator built without them refuses the traces of that format.
+**/
+#ifndef TOMSIM_ZLIB
+#define TOMSIM_ZLIB 0
+#endif
+#ifndef TOMSIM_ZSTD
+#define TOMSIM_ZSTD 0
+#endif
+
+#define DecompressedBlockSize (256 * 1024) //bytes of decompressed text per block
+#define DecompressedBlocks 8 //blocks in the ring, the decompression can run this many blocks ahead of the reader
+
+enum traceCompression { NotCompressed, GzipCompressed, ZstdCompressed };
+
+//Compression of a file from its first bytes, NotCompressed if the file cannot be read
+traceCompression compressionOf(const std::string& fileName);
+//Compression of a stream from its first 'size' bytes
+traceCompression compressionOf(const unsigned char* magic, std::size_t size);
+
+//Ring of decompressed blocks, filled by the decompression thread and read through the streambuf interface
+class decompressingBuffer : public std::streambuf {
+public:
+	~decompressingBuffer();
+
+	//Start the decompression of the file
+	//returns false if the file cannot be read or the format is not supported by this build
+	bool open(const std::string& fileName, traceCompression compression);
+	//Start the decompression of the standard input, 'start' holds the bytes already read from it
+	bool openStandardInput(const std::string& start, traceCompression compression);
+	void close();
+	bool isOpen() const { return producer.joinable(); }
+
+	//returns true if the text ended early because the compressed file is corrupt or truncated
+	bool failed() const { return corrupt.load(std::memory_order_acquire); }
+
+protected:
+	int_type underflow() override;
+
+private:
+	struct block {
+		std::vector<char> text; //DecompressedBlockSize bytes once a file is opened
+		std::size_t size = 0;
+	};
+	block blocks[DecompressedBlocks];
+	//blocks [head, tail) hold text, the reader owns block head while 'reading' is set, the decompression thread
+	//owns block tail. Both only grow, the block of index i is blocks[i % DecompressedBlocks]
+	std::atomic<unsigned long long> head{ 0 };
+	std::atomic<unsigned long long> tail{ 0 };
+	std::atomic<bool> finished{ false }; //no block will be added after tail
+	std::atomic<bool> corrupt{ false };
+	std::atomic<bool> stopping{ false }; //the reader closes the stream before its end
+	bool reading = false;
+	std::size_t filled = 0; //bytes written in block tail, only used by the decompression thread
+	std::ifstream file;
+	std::istream* source = nullptr; //the file or the standard input
+	std::string start; //bytes of the source read before the decompression started, decompressed first
+	traceCompression compression = NotCompressed;
+	std::thread producer;
+
+	bool supported(traceCompression compression, const std::string& name) const;
+	void startProducer(traceCompression compression);
+	std::size_t readCompressed(char* data, std::size_t size);
+	void decompress();
+	bool decompressGzip();
+	bool decompressZstd();
+	char* freeSpace(std::size_t& space);
+	void addText(std::size_t size);
+	void publishBlock();
+};
+
+//Decompressed text of a compressed trace, read with getline() like a plain trace file
+class decompressingStream : public std::istream {
+public:
+	decompressingStream() : std::istream(nullptr) { rdbuf(&buffer); }
+
+	bool open(const std::string& fileName, traceCompression compression);
+	bool openStandardInput(const std::string& start, traceCompression compression);
+	void close() { buffer.close(); }
+	bool isOpen() const { return buffer.isOpen(); }
+	bool failed() const { return buffer.failed(); }
+
+private:
+	decompressingBuffer buffer;
+};
@@ -0,0 +1,169 @@
+#include "fstream"
+#include "algorithm"
+
+#include "functional.h"
+
+using namespace std;
+
+//16 bit two's complement result of an operation computed on int
+static inline signed short wrap(int value)
+{
+	return (signed short)(unsigned short)value;
+}
+
+static signed short power(signed short base, signed short exponent)
+{
+	if (exponent < 0)
+	{
+		//1 / base^-exponent, only 1 and -1 have a non zero integer part
+		if (base == 1)
+		{
+			return 1;
+		}
+		if (base == -1)
+		{
+			return (exponent & 1) ? -1 : 1;
+		}
+		return 0;
+	}
+	unsigned int result = 1;
+	unsigned int factor = (unsigned short)base;
+	for (unsigned int remaining = exponent; remaining != 0; remaining >>= 1)
+	{
+		if (remaining & 1)
+		{
+			result = (result * factor) & 0xffff;
+		}
+		factor = (factor * factor) & 0xffff;
+	}
+	return wrap(result);
+}
+
+//Value of the operation of an R, I or lui format instruction
+static inline signed short operate(const decodedInstruction& inst, signed short source1, signed short source2)
+{
+	switch (inst.opcode)
+	{
+	case 0: //add
+		return wrap(source1 + source2);
+	case 1: //sub
+		return wrap(source1 - source2);
+	case 2: //and
+		return source1 & source2;
+	case 3: //nor
+		return ~(source1 | source2);
+	case 4: //div
+		return source2 == 0 ? 0 : wrap(source1 / source2);
+	case 5: //mul
+		return wrap(source1 * source2);
+	case 6: //mod
+		return source2 == 0 ? 0 : wrap(source1 % source2);
+	case 7: //exp
+		return power(source1, source2);
+	case 16: //liz
+		return inst.immediate;
+	case 17: //lis
+		return (signed char)inst.immediate;
+	case 18: //lui
+		return wrap((inst.immediate << 8) | (source1 & 0xff));
+	default:
+		return 0;
+	}
+}
+
+signed short computeValue(const decodedInstruction& inst, signed short source1, signed short source2)
+{
+	return operate(inst, source1, source2);
+}
+
+//One instruction on the state, shared by the two entry points so the fast path is the same code inlined
+//The switch is on the opcode, one indirect branch per instruction; an unused register field is NoRegister, so the
+//operands are only read by the cases which use them
+static inline void execute(signed short* registers, signed short* memory, std::vector<signed short>& output,
+	const decodedInstruction& inst, instructionOutcome& outcome)
+{
+	switch (inst.opcode)
+	{
+	case 8: //lw
+		outcome.address = (unsigned short)registers[inst.source1];
+		outcome.value = memory[outcome.address];
+		registers[inst.destination] = outcome.value;
+		break;
+	case 9: //sw
+		outcome.address = (unsigned short)registers[inst.source2];
+		outcome.value = registers[inst.source1];
+		memory[outcome.address] = outcome.value;
+		break;
+	case 14: //put
+		outcome.value = registers[inst.source1];
+		output.push_back(outcome.value);
+		break;
+	case 13: //halt
+		break;
+	case 16: //liz
+	case 17: //lis
+		outcome.value = operate(inst, 0, 0);
+		registers[inst.destination] = outcome.value;
+		break;
+	case 18: //lui
+		outcome.value = operate(inst, registers[inst.source1], 0);
+		registers[inst.destination] = outcome.value;
+		break;
+	default:
+		outcome.value = operate(inst, registers[inst.source1], registers[inst.source2]);
+		registers[inst.destination] = outcome.value;
+		break;
+	}
+}
+
+void executeInstruction(architecturalState& state, const decodedInstruction& inst, instructionOutcome& outcome)
+{
+	outcome = instructionOutcome();
+	execute(state.registers, state.memory.data(), state.output, inst, outcome);
+	state.executed += 1;
+}
+
+void executeInstructions(architecturalState& state, const decodedInstruction* instructions, unsigned long long count)
+{
+	//the registers stay in a local copy for the whole loop
+	signed short registers[NumberOfRegisters];
+	std::copy(state.registers, state.registers + NumberOfRegisters, registers);
+	signed short* memory = state.memory.data();
+	instructionOutcome outcome;
+	for (unsigned long long i = 0; i < count; i++)
+	{
+		execute(registers, memory, state.output, instructions[i], outcome);
+	}
+	std::copy(registers, registers + NumberOfRegisters, state.registers);
+	state.executed += count;
+}
+
+void writeStateFile(const std::string& fileName, const architecturalState& state)
+{
+	ofstream stateFile;
+	stateFile.open(fileName);
+	stateFile << "{\"instructions\":" << state.executed << " ," << endl;
+	stateFile << "\"registers\" : [";
+	for (int i = 0; i < NumberOfRegisters; i++)
+	{
+		stateFile << state.registers[i] << (i != NumberOfRegisters - 1 ? ", " : "");
+	}
+	stateFile << "]," << endl;
+	stateFile << "\"output\" : [";
+	for (std::size_t i = 0; i < state.output.size(); i++)
+	{
+		stateFile << state.output[i] << (i != state.output.size() - 1 ? ", " : "");
+	}
+	stateFile << "]," << endl;
+	stateFile << "\"memory\" : [";
+	bool first = true;
+	for (int address = 0; address < MemoryWords; address++)
+	{
+		if (state.memory[address] != 0)
+		{
+			stateFile << (first ? "" : ", ") << "{ \"address\" : " << address << " , \"value\" : " << state.memory[address] << " }";
+			first = false;
+		}
+	}
+	stateFile << "]}" << endl;
+}
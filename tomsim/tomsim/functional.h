@@ -0,0 +1,48 @@
+#pragma once
+
+#include "string"
+#include "vector"
+
+#include "trace.h"
+
+//Functional model of the ISA: it computes the values of the instructions, without any timing
+/** The registers and the memory words are 16 bit, the memory has one word per address and an address is the unsigned
+	value of a register. Everything starts at 0.
+		add, sub, mul: the result wraps around on 16 bits
+		and, nor: bitwise
+		div, mod: truncated towards 0, a division by 0 gives 0
+		exp: Rs to the power Rt, wraps around on 16 bits, a negative power gives the integer part of the result
+		liz, lis: the immediate, zero or sign extended
+		lui: the immediate in the upper byte, the lower byte of Rd is kept
+		lw $rd, $rs: Rd = memory[Rs]
+		sw $rt, $rs: memory[Rs] = Rt
+		put $rs: prints Rs
+		halt: nothing, a trace holds the instructions which were executed so it goes on after a halt
+**/
+#define MemoryWords 65536
+
+struct architecturalState {
+	signed short registers[NumberOfRegisters] = { 0 };
+	std::vector<signed short> memory = std::vector<signed short>(MemoryWords);
+	std::vector<signed short> output; //values printed by put, in program order
+	unsigned long long executed = 0; //number of instructions executed
+};
+
+//What an instruction did: the value written to Rd, stored by sw or printed by put, and the address of lw and sw
+struct instructionOutcome {
+	signed short value = 0;
+	unsigned short address = 0;
+};
+
+//Value computed by an instruction which does not access the memory (R, I and lui formats)
+signed short computeValue(const decodedInstruction& inst, signed short source1, signed short source2);
+
+//Execute one instruction and update the state
+void executeInstruction(architecturalState& state, const decodedInstruction& inst, instructionOutcome& outcome);
+
+//Execute 'count' instructions of a decoded or mapped trace, the fast path: nothing is recorded but the state
+void executeInstructions(architecturalState& state, const decodedInstruction* instructions, unsigned long long count);
+
+//Write the final state in a file: the number of instructions, the registers, the values printed by put and the memory
+//words which are not 0
+void writeStateFile(const std::string& fileName, const architecturalState& state);
@@ -0,0 +1,293 @@
+#include "iostream"
+#include "sstream"
+#include "string"
+#include "vector"
+#include "cmath"
+#include "algorithm"
+#include "cstdlib"
+
+#include "generator.h"
+#include "simulator.h"
+
+using namespace std;
+
+#define NumberOfProducedRegisters 4 //OneWay: r0-r3 are written by the producers
+#define ConstantRegister 7 //OneWay: never written
+#define GeneratorBufferSize 65536
+
+//xorshift64*, the same sequence on every compiler unlike the distributions of "random"
+static inline unsigned long long nextRandom(unsigned long long& state)
+{
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * 2685821657736338717ULL;
+}
+
+//uniform in [0, 1)
+static inline double nextProbability(unsigned long long& state)
+{
+	return (nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//Parse "name=weight,name=weight,..." where each name is one of 'count' names of 'nameOf'
+//returns false if a name is unknown or a weight is not a number
+static bool parseWeights(const std::string& value, const char* (*nameOf)(int), int count, int* weights)
+{
+	string item;
+	istringstream items(value);
+	while (getline(items, item, ','))
+	{
+		std::size_t equal = item.find('=');
+		if (equal == std::string::npos)
+		{
+			return false;
+		}
+		std::string name = item.substr(0, equal);
+		int index = 0;
+		while (index < count && name != nameOf(index))
+		{
+			index++;
+		}
+		char* end = nullptr;
+		long weight = std::strtol(item.c_str() + equal + 1, &end, 10);
+		if (index == count || equal + 1 == item.length() || *end != '\0' || weight < 0)
+		{
+			return false;
+		}
+		weights[index] = weight;
+	}
+	return true;
+}
+
+static const char* functionalUnitName(int typeFU)
+{
+	return functionalUnitNames[typeFU];
+}
+
+bool parseOpcodeWeights(const std::string& value, traceGeneratorSettings& settings)
+{
+	//the opcodes which are not listed are not generated
+	int weights[NumberOfOpcodes] = { 0 };
+	if (parseWeights(value, opcodeName, NumberOfOpcodes, weights) == false)
+	{
+		return false;
+	}
+	std::copy(weights, weights + NumberOfOpcodes, settings.opcodeWeights);
+	return true;
+}
+
+bool parseMix(const std::string& value, traceGeneratorSettings& settings)
+{
+	int mix[FUType] = { 0 };
+	if (parseWeights(value, functionalUnitName, FUType, mix) == false)
+	{
+		return false;
+	}
+	std::copy(mix, mix + FUType, settings.mix);
+	return true;
+}
+
+bool parseDistance(const std::string& value, traceGeneratorSettings& settings)
+{
+	std::size_t colon = value.find(':');
+	std::string kind = value.substr(0, colon);
+	int distance = colon == std::string::npos ? 0 : std::atoi(value.c_str() + colon + 1);
+	if (distance < 1 || distance > MaxDependencyDistance)
+	{
+		return false;
+	}
+	if (kind == "uniform")
+	{
+		settings.distances = UniformDistance;
+	}
+	else if (kind == "geometric")
+	{
+		settings.distances = GeometricDistance;
+	}
+	else if (kind == "fixed")
+	{
+		settings.distances = FixedDistance;
+	}
+	else
+	{
+		return false;
+	}
+	settings.distance = distance;
+	return true;
+}
+
+bool parseDependencyMode(const std::string& value, dependencyMode& mode)
+{
+	if (value == "one-way")
+	{
+		mode = OneWay;
+	}
+	else if (value == "any")
+	{
+		mode = AnyRegister;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+bool generateTrace(const traceGeneratorSettings& settings, std::ostream& output)
+{
+	//the opcodes of each type of FU, from the decoder so the generator knows the same instructions as the simulator
+	std::vector<int> opcodes[FUType];
+	std::vector<int> opcodeWeights[FUType];
+	int typeWeights[FUType] = { 0 }; //total weight of the opcodes of each type
+	for (int opcode = 0; opcode < NumberOfOpcodes; opcode++)
+	{
+		decodedInstruction inst;
+		bool error = false;
+		//lui reads its destination, it can only be generated when any register can be read
+		bool allowed = settings.dependencies == AnyRegister || opcode != 18;
+		if (settings.opcodeWeights[opcode] > 0 && allowed && decodeWord((unsigned short)(opcode << 11), inst, error))
+		{
+			opcodes[inst.functionalUnitType].push_back(opcode);
+			opcodeWeights[inst.functionalUnitType].push_back(settings.opcodeWeights[opcode]);
+			typeWeights[inst.functionalUnitType] += settings.opcodeWeights[opcode];
+		}
+	}
+	int mix[FUType];
+	int totalWeight = 0;
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		mix[typeFU] = typeWeights[typeFU] > 0 ? settings.mix[typeFU] : 0;
+		totalWeight += mix[typeFU];
+	}
+	//the errors go to cerr, the trace itself may be written to the standard output
+	if (totalWeight == 0)
+	{
+		cerr << "Error: No instruction to generate" << endl;
+		return false;
+	}
+	unsigned long long state = settings.seed * 0x9E3779B97F4A7C15ULL + 1;
+	//destinations of the last instructions which can be depended upon, the last one at 'recent' - 1
+	int recentResults[MaxDependencyDistance];
+	std::fill(recentResults, recentResults + MaxDependencyDistance, ConstantRegister);
+	int recent = 0;
+	double geometric = settings.distances == GeometricDistance ? std::log(1 - 1.0 / settings.distance) : 0;
+	auto pickSource = [&]()
+	{
+		if (nextProbability(state) < settings.dependency)
+		{
+			int distance = settings.distance;
+			if (settings.distances == UniformDistance)
+			{
+				distance = 1 + nextRandom(state) % settings.distance;
+			}
+			else if (settings.distances == GeometricDistance)
+			{
+				//number of trials until the first success, with a probability of success of 1 / 'distance'
+				distance = 1 + (int)(std::log(1 - nextProbability(state)) / geometric);
+				distance = std::min(distance, MaxDependencyDistance);
+			}
+			return recentResults[(recent + MaxDependencyDistance - distance) % MaxDependencyDistance];
+		}
+		return settings.dependencies == OneWay ? ConstantRegister : (int)(nextRandom(state) % NumberOfRegisters);
+	};
+	auto addResult = [&](int destination)
+	{
+		recentResults[recent] = destination;
+		recent = (recent + 1) % MaxDependencyDistance;
+	};
+	static const char hexDigits[] = "0123456789abcdef";
+	std::vector<char> buffer(GeneratorBufferSize);
+	std::size_t used = 0;
+	for (unsigned long long i = 0; i < settings.length; i++)
+	{
+		int weight = nextRandom(state) % totalWeight;
+		int typeFU = 0;
+		while (weight >= mix[typeFU])
+		{
+			weight -= mix[typeFU++];
+		}
+		weight = nextRandom(state) % typeWeights[typeFU];
+		int choice = 0;
+		while (weight >= opcodeWeights[typeFU][choice])
+		{
+			weight -= opcodeWeights[typeFU][choice++];
+		}
+		int opcode = opcodes[typeFU][choice];
+		unsigned int encoded = opcode << 11;
+		if (opcode == 9 || opcode == 14) //sw $rt, $rs and put $rs: no destination
+		{
+			int source = pickSource();
+			encoded |= source << 5;
+			if (opcode == 9)
+			{
+				encoded |= pickSource() << 2;
+			}
+		}
+		else if (opcode == 13) //halt
+		{
+			//no operand
+		}
+		else if (settings.dependencies == OneWay)
+		{
+			if (opcode == 8 || opcode == 16 || opcode == 17) //producers: lw $rd, $r7 and liz, lis
+			{
+				int destination = nextRandom(state) % NumberOfProducedRegisters;
+				encoded |= destination << 8 | (opcode == 8 ? ConstantRegister << 5 : nextRandom(state) & 0xff);
+				addResult(destination);
+			}
+			else
+			{
+				int destination = NumberOfProducedRegisters + nextRandom(state) % (ConstantRegister - NumberOfProducedRegisters);
+				int source1 = pickSource();
+				encoded |= destination << 8 | source1 << 5 | pickSource() << 2;
+			}
+		}
+		else
+		{
+			int destination = 0;
+			if (opcode == 18) //lui $rd reads its destination
+			{
+				destination = pickSource();
+				encoded |= destination << 8 | (nextRandom(state) & 0xff);
+			}
+			else if (opcode == 16 || opcode == 17) //liz, lis
+			{
+				destination = nextRandom(state) % NumberOfRegisters;
+				encoded |= destination << 8 | (nextRandom(state) & 0xff);
+			}
+			else if (opcode == 8) //lw $rd, $rs
+			{
+				destination = nextRandom(state) % NumberOfRegisters;
+				encoded |= destination << 8 | pickSource() << 5;
+			}
+			else
+			{
+				destination = nextRandom(state) % NumberOfRegisters;
+				int source1 = pickSource();
+				encoded |= destination << 8 | source1 << 5 | pickSource() << 2;
+			}
+			addResult(destination);
+		}
+		char* line = buffer.data() + used;
+		line[0] = hexDigits[encoded >> 12];
+		line[1] = hexDigits[(encoded >> 8) & 0xf];
+		line[2] = hexDigits[(encoded >> 4) & 0xf];
+		line[3] = hexDigits[encoded & 0xf];
+		line[4] = '\n';
+		used += 5;
+		if (used + 5 > buffer.size())
+		{
+			output.write(buffer.data(), used);
+			used = 0;
+		}
+	}
+	output.write(buffer.data(), used);
+	output.flush();
+	if (!output.good())
+	{
+		cerr << "Error: Cannot write the trace" << endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ostream"
+#include "string"
+
+#include "trace.h"
+
+//Synthetic traces, in the text format readTraceFile() decodes: one 16 bit instruction per line, 4 hex digits
+//The trace is written as it is generated, nothing is kept but the last destinations, so its length has no limit.
+/** Dependencies
+	OneWay: the producers (lw, liz, lis) write r0-r3 and read only r7, which is never written; the other instructions
+		write r4-r6 and read the destinations of earlier producers or r7, and only the stores read r4-r6. The pipeline
+		deadlocks on a consumer which reads its operand in the cycle its producer broadcasts it, when the next
+		instruction using that reservation station depends on the consumer (see the check mode); with one way
+		dependencies this cannot happen before the end of the trace.
+	AnyRegister: every instruction writes and reads any register, the sources read the destinations of earlier
+		instructions. This is what real code looks like, but most such traces deadlock the pipeline.
+	A source operand depends on an earlier instruction with probability 'dependency'. The distance, counted in
+	instructions which can be depended upon (the producers in OneWay mode), is drawn from the distance distribution;
+	otherwise the operand reads r7 (OneWay) or any register (AnyRegister).
+**/
+enum dependencyMode { OneWay, AnyRegister };
+enum distanceDistribution { UniformDistance, GeometricDistance, FixedDistance };
+
+#define MaxDependencyDistance 1024
+
+struct traceGeneratorSettings {
+	unsigned long long length = 1000000; //number of instructions
+	unsigned long long seed = 1;
+	//relative weight of each opcode, an opcode with weight 0 is not generated. The default is every opcode of the
+	//five types of FU except halt, put and lui
+	int opcodeWeights[NumberOfOpcodes] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 1, 1 };
+	//relative weight of the instructions of each type of FU, shared by the opcodes of the type as their weights say
+	int mix[FUType] = { 6, 1, 1, 2, 1 };
+	dependencyMode dependencies = OneWay;
+	double dependency = 0.5;
+	distanceDistribution distances = UniformDistance;
+	int distance = 4; //Uniform: the largest distance, Geometric: the mean distance, Fixed: the distance
+};
+
+//Parse the options of the generator ("--mix integer=6,divider=1,...", "--distance uniform:8", ...) into 'settings'
+//returns false if the value is not valid
+bool parseOpcodeWeights(const std::string& value, traceGeneratorSettings& settings);
+bool parseMix(const std::string& value, traceGeneratorSettings& settings);
+bool parseDistance(const std::string& value, traceGeneratorSettings& settings);
+bool parseDependencyMode(const std::string& value, dependencyMode& mode);
+
+//Write the trace to 'output'
+//returns false if the settings generate nothing (every weight is 0) or the trace cannot be written
+bool generateTrace(const traceGeneratorSettings& settings, std::ostream& output);
@@ -0,0 +1,218 @@
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include "intrin.h"
+#include "immintrin.h"
+#define HexSimd 1
+#define HexSimdTarget(isa) //MSVC compiles the intrinsics of any instruction set
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include "immintrin.h"
+#define HexSimd 1
+#define HexSimdTarget(isa) __attribute__((target(isa)))
+#else
+#define HexSimd 0
+#endif
+
+#include "hexparse.h"
+
+using namespace std;
+
+const char* hexParserNames[NumberOfHexParsers] = { "scalar", "sse4.2", "avx2" };
+
+//Value of each character as a hex digit, -1 if it is not one
+struct hexDigitTable {
+	signed char value[256];
+
+	hexDigitTable()
+	{
+		for (int c = 0; c < 256; c++)
+		{
+			value[c] = -1;
+		}
+		for (int d = 0; d < 10; d++)
+		{
+			value['0' + d] = (signed char)d;
+		}
+		for (int d = 0; d < 6; d++)
+		{
+			value['a' + d] = (signed char)(10 + d);
+			value['A' + d] = (signed char)(10 + d);
+		}
+	}
+};
+static const hexDigitTable hexDigits;
+
+//One line, 'line' has at least HexLineSize bytes
+static inline bool parseHexLine(const char* line, unsigned short& word)
+{
+	int d0 = hexDigits.value[(unsigned char)line[0]];
+	int d1 = hexDigits.value[(unsigned char)line[1]];
+	int d2 = hexDigits.value[(unsigned char)line[2]];
+	int d3 = hexDigits.value[(unsigned char)line[3]];
+	if ((d0 | d1 | d2 | d3) < 0 || line[4] != '\n')
+	{
+		return false;
+	}
+	word = (unsigned short)((d0 << 12) | (d1 << 8) | (d2 << 4) | d3);
+	return true;
+}
+
+#if HexSimd
+
+//In 16 bytes, the 3 lines start at bytes 0, 5 and 10: the digits are the bytes of HexDigitBytes and the ends of line the
+//bytes of HexLineEnds. The last byte belongs to the next line
+#define HexDigitBytes 0x3def
+#define HexLineEnds 0x4210
+
+//Three lines of 16 bytes
+HexSimdTarget("sse4.2")
+static bool parseHexLinesSse(const char* text, unsigned short* words)
+{
+	__m128i bytes = _mm_loadu_si128((const __m128i*)text);
+	//c - '0' is at most 9 for a decimal digit, (c | 0x20) - 'a' at most 5 for a letter, in unsigned bytes
+	__m128i digits = _mm_sub_epi8(bytes, _mm_set1_epi8('0'));
+	__m128i letters = _mm_sub_epi8(_mm_or_si128(bytes, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+	__m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+	__m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(5)), letters);
+	int hex = _mm_movemask_epi8(_mm_or_si128(isDigit, isLetter));
+	int lineEnds = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')));
+	if ((hex & HexDigitBytes) != HexDigitBytes || (lineEnds & HexLineEnds) != HexLineEnds)
+	{
+		return false;
+	}
+	__m128i nibbles = _mm_blendv_epi8(_mm_add_epi8(letters, _mm_set1_epi8(10)), digits, isDigit);
+	//the digits of the 3 lines next to each other, then 16 * high + low for each pair and 256 * high + low pair
+	__m128i packed = _mm_shuffle_epi8(nibbles, _mm_setr_epi8(0, 1, 2, 3, 5, 6, 7, 8, 10, 11, 12, 13, -1, -1, -1, -1));
+	__m128i pairs = _mm_maddubs_epi16(packed, _mm_set1_epi16(0x0110));
+	__m128i values = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00010100));
+	int lanes[4];
+	_mm_storeu_si128((__m128i*)lanes, values);
+	words[0] = (unsigned short)lanes[0];
+	words[1] = (unsigned short)lanes[1];
+	words[2] = (unsigned short)lanes[2];
+	return true;
+}
+
+//Six lines, from 31 bytes: the lines 0 to 2 in the low lane and the lines 3 to 5 from byte 15 in the high lane, so both
+//lanes have the layout of parseHexLinesSse()
+HexSimdTarget("avx2")
+static bool parseHexLinesAvx2(const char* text, unsigned short* words)
+{
+	__m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)text)),
+		_mm_loadu_si128((const __m128i*)(text + 3 * HexLineSize)), 1);
+	__m256i digits = _mm256_sub_epi8(bytes, _mm256_set1_epi8('0'));
+	__m256i letters = _mm256_sub_epi8(_mm256_or_si256(bytes, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+	__m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digits, _mm256_set1_epi8(9)), digits);
+	__m256i isLetter = _mm256_cmpeq_epi8(_mm256_min_epu8(letters, _mm256_set1_epi8(5)), letters);
+	unsigned int hex = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(isDigit, isLetter));
+	unsigned int lineEnds = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n')));
+	const unsigned int digitBytes = HexDigitBytes | (HexDigitBytes << 16);
+	const unsigned int lineEndBytes = HexLineEnds | (HexLineEnds << 16);
+	if ((hex & digitBytes) != digitBytes || (lineEnds & lineEndBytes) != lineEndBytes)
+	{
+		return false;
+	}
+	__m256i nibbles = _mm256_blendv_epi8(_mm256_add_epi8(letters, _mm256_set1_epi8(10)), digits, isDigit);
+	__m256i packed = _mm256_shuffle_epi8(nibbles, _mm256_setr_epi8(0, 1, 2, 3, 5, 6, 7, 8, 10, 11, 12, 13, -1, -1, -1, -1,
+		0, 1, 2, 3, 5, 6, 7, 8, 10, 11, 12, 13, -1, -1, -1, -1));
+	__m256i pairs = _mm256_maddubs_epi16(packed, _mm256_set1_epi16(0x0110));
+	__m256i values = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00010100));
+	int lanes[8];
+	_mm256_storeu_si256((__m256i*)lanes, values);
+	words[0] = (unsigned short)lanes[0];
+	words[1] = (unsigned short)lanes[1];
+	words[2] = (unsigned short)lanes[2];
+	words[3] = (unsigned short)lanes[4];
+	words[4] = (unsigned short)lanes[5];
+	words[5] = (unsigned short)lanes[6];
+	return true;
+}
+
+#endif
+
+//Instruction sets of the processor, AVX2 also needs the operating system to save the 256 bit registers
+struct processorFeatures {
+	bool sse42 = false;
+	bool avx2 = false;
+
+	processorFeatures()
+	{
+#if HexSimd && defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+		__cpuid(info, 1);
+		sse42 = (info[2] & (1 << 20)) != 0;
+		bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+		if (maxLeaf >= 7 && osSavesAvx)
+		{
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+		}
+#elif HexSimd
+		__builtin_cpu_init();
+		sse42 = __builtin_cpu_supports("sse4.2") != 0;
+		avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+	}
+};
+
+static const processorFeatures& features()
+{
+	static const processorFeatures detected;
+	return detected;
+}
+
+bool hexParserSupported(hexParser parser)
+{
+	switch (parser)
+	{
+	case ScalarHexParser: return true;
+	case Sse42HexParser: return features().sse42;
+	case Avx2HexParser: return features().sse42 && features().avx2; //the AVX2 parser ends its runs with the SSE4.2 one
+	default: return false;
+	}
+}
+
+hexParser fastestHexParser()
+{
+	if (hexParserSupported(Avx2HexParser))
+	{
+		return Avx2HexParser;
+	}
+	return hexParserSupported(Sse42HexParser) ? Sse42HexParser : ScalarHexParser;
+}
+
+std::size_t parseHexWords(hexParser parser, const char* text, std::size_t size, unsigned short* words, std::size_t capacity,
+	std::size_t& consumed)
+{
+	std::size_t count = 0;
+	const char* line = text;
+	const char* end = text + size;
+	while (count < capacity)
+	{
+#if HexSimd
+		if (parser == Avx2HexParser && capacity - count >= 6 && end - line >= 6 * HexLineSize + 1 &&
+			parseHexLinesAvx2(line, words + count))
+		{
+			count += 6;
+			line += 6 * HexLineSize;
+			continue;
+		}
+		if (parser != ScalarHexParser && capacity - count >= 3 && end - line >= 3 * HexLineSize + 1 &&
+			parseHexLinesSse(line, words + count))
+		{
+			count += 3;
+			line += 3 * HexLineSize;
+			continue;
+		}
+#endif
+		if (end - line >= HexLineSize && parseHexLine(line, words[count]))
+		{
+			count += 1;
+			line += HexLineSize;
+			continue;
+		}
+		break;
+	}
+	consumed = line - text;
+	return count;
+}
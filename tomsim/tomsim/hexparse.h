@@ -0,0 +1,30 @@
+#pragma once
+
+#include "cstddef"
+
+//Parsing of the hex words of a text trace
+/** Nearly every line of a text trace is one 16 bit word written as 4 hex digits and an end of line. parseHexWords()
+	converts a run of such lines straight into words, without the string and the std::stoi() of decodeInstruction().
+	The SSE4.2 parser checks and converts 3 lines (16 bytes) at once, the AVX2 parser 6 lines, one group of 3 in each
+	128 bit lane. Both go on with the scalar parser for the lines they cannot take as a group. A line which is not
+	exactly 4 hex digits (comment, empty line, CRLF end, more digits...) stops the run; the caller decodes it with
+	decodeInstruction() as before, so every line still gets the same instruction.
+	The parser is chosen at run time from the processor, the SIMD parsers are only built for x86.
+**/
+#define HexLineSize 5 //4 hex digits and the end of line
+
+enum hexParser { ScalarHexParser, Sse42HexParser, Avx2HexParser, NumberOfHexParsers };
+
+extern const char* hexParserNames[NumberOfHexParsers];
+
+//returns true if the processor runs the parser
+bool hexParserSupported(hexParser parser);
+
+//Fastest parser the processor runs
+hexParser fastestHexParser();
+
+//Convert the lines of exactly 4 hex digits at the start of the text into words, at most 'capacity' of them.
+//'consumed' is set to the number of bytes of these lines
+//returns the number of words, less than capacity only if the next line is not 4 hex digits or the text ends
+std::size_t parseHexWords(hexParser parser, const char* text, std::size_t size, unsigned short* words, std::size_t capacity,
+	std::size_t& consumed);
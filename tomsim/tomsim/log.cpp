@@ -0,0 +1,86 @@
+#include "iostream"
+#include "fstream"
+
+#include "log.h"
+
+using namespace std;
+
+bool parseLogLevel(const std::string& name, int& level)
+{
+	if (name == "none")
+	{
+		level = LogNone;
+	}
+	else if (name == "info")
+	{
+		level = LogInfo;
+	}
+	else if (name == "debug")
+	{
+		level = LogDebug;
+	}
+	else if (name == "trace")
+	{
+		level = LogTrace;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+bool parseLogCycles(const std::string& range, long long& firstCycle, long long& lastCycle)
+{
+	std::size_t separator = range.find(':');
+	if (separator == std::string::npos)
+	{
+		return false;
+	}
+	std::string first = range.substr(0, separator);
+	std::string last = range.substr(separator + 1);
+	try
+	{
+		firstCycle = first.empty() ? 0 : std::stoll(first);
+		lastCycle = last.empty() ? -1 : std::stoll(last);
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+	return firstCycle >= 0 && (lastCycle < 0 || lastCycle >= firstCycle);
+}
+
+bool openLog(logSettings& settings, const std::string& fileName)
+{
+	if (fileName == "-")
+	{
+		//the log is much larger than anything else the simulator prints, cout does not need to stay in sync with stdio
+		std::ios_base::sync_with_stdio(false);
+		settings.sink = &cout;
+		return true;
+	}
+	settings.buffer.reset(new char[LogSinkBufferSize]);
+	settings.file.reset(new ofstream());
+	settings.file->rdbuf()->pubsetbuf(settings.buffer.get(), LogSinkBufferSize);
+	settings.file->open(fileName);
+	if (!settings.file->is_open())
+	{
+		cout << "Cannot create the log file" << endl;
+		settings.file.reset();
+		return false;
+	}
+	settings.sink = settings.file.get();
+	return true;
+}
+
+void closeLog(logSettings& settings)
+{
+	settings.sink->flush();
+	if (settings.file != nullptr)
+	{
+		settings.file->close();
+		settings.file.reset();
+	}
+	settings.sink = &cout;
+}
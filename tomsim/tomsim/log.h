@@ -0,0 +1,60 @@
+#pragma once
+
+#include "iostream"
+#include "fstream"
+#include "string"
+#include "memory"
+
+//Levels of the simulation log, each level also prints everything of the levels before it
+/** LogNone: nothing is logged
+	LogInfo: state of the machine before the first cycle
+	LogDebug: state of the reservation stations, registers and functional units at the end of every cycle
+	LogTrace: upcoming trace instructions at the end of every cycle and one line per pipeline event of an instruction
+**/
+enum logLevel { LogNone, LogInfo, LogDebug, LogTrace };
+
+//Highest level compiled in. Logging calls above this level are removed by the compiler, build with
+//TOMSIM_MAX_LOG_LEVEL=LogNone to remove the logging completely
+#ifndef TOMSIM_MAX_LOG_LEVEL
+#define TOMSIM_MAX_LOG_LEVEL LogTrace
+#endif
+
+#define LogSinkBufferSize (1 << 20) //bytes buffered by a log file before they are written
+
+//Log of one simulation. Every simulator has its own, so simulations running on different threads do not share a sink
+struct logSettings {
+	int level = LogNone; //run-time level, at most TOMSIM_MAX_LOG_LEVEL has an effect
+	long long firstCycle = 0; //only the cycles in [firstCycle, lastCycle] are logged
+	long long lastCycle = -1; //-1: no upper limit
+	std::ostream* sink = &std::cout; //stream the log is written to
+	std::unique_ptr<std::ofstream> file; //set by openLog() when the log goes to a file
+	std::unique_ptr<char[]> buffer; //buffer of the file
+
+	//returns true if a message of this level about clock cycle CC has to be written
+	bool enabled(int messageLevel, long long CC) const
+	{
+		return messageLevel <= TOMSIM_MAX_LOG_LEVEL && messageLevel <= level &&
+			CC >= firstCycle && (lastCycle < 0 || CC <= lastCycle);
+	}
+};
+
+//Write one log message: LOG(LogTrace, CC) << "..." << '\n';
+//Writes to the logSettings named logConfig in the current scope. The message is not evaluated when the level or the
+//cycle is filtered out
+#define LOG(level, CC) if (logConfig.enabled(level, CC) == false) {} else *logConfig.sink
+
+//Parse a level name (none, info, debug, trace)
+//returns false if the name is unknown
+bool parseLogLevel(const std::string& name, int& level);
+
+//Parse a cycle range "first:last", either bound may be left out
+//returns false if the range is malformed
+bool parseLogCycles(const std::string& range, long long& firstCycle, long long& lastCycle);
+
+//Open the sink of a log, fileName "-" is the standard output. The standard output is shared by the whole process,
+//simulations running on several threads must log to separate files
+//returns false if the file cannot be created
+bool openLog(logSettings& settings, const std::string& fileName);
+
+//Write what is left in the buffer of the sink
+void closeLog(logSettings& settings);
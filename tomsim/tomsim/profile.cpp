@@ -0,0 +1,177 @@
+#include "iostream"
+#include "iomanip"
+#include "cstring"
+
+#ifdef __linux__
+#include "linux/perf_event.h"
+#include "sys/syscall.h"
+#include "sys/ioctl.h"
+#include "unistd.h"
+#endif
+
+#include "profile.h"
+
+using namespace std;
+
+const char* profiledStageNames[ProfiledStages] = { "issue", "read", "execute", "write back 1", "write back 2", "stall" };
+
+const char* hardwareCounterNames[HardwareCounters] = { "instructions", "cache misses", "branch misses" };
+
+#ifdef __linux__
+//Open one counter of the user space of this thread, stopped. The counters after the first are in its group, so they
+//are started and stopped together
+//returns -1 if the host does not have the counter or does not allow it
+static int openCounter(unsigned long long config, int groupFile)
+{
+	perf_event_attr attributes;
+	memset(&attributes, 0, sizeof(attributes));
+	attributes.size = sizeof(attributes);
+	attributes.type = PERF_TYPE_HARDWARE;
+	attributes.config = config;
+	attributes.disabled = groupFile == -1 ? 1 : 0;
+	attributes.exclude_kernel = 1;
+	attributes.exclude_hv = 1;
+	return (int)syscall(SYS_perf_event_open, &attributes, 0, -1, groupFile, 0);
+}
+#endif
+
+void startProfile(stageProfile& profile)
+{
+	if (profile.active() == false)
+	{
+		return;
+	}
+#ifdef __linux__
+	static const unsigned long long configs[HardwareCounters] = { PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES };
+	int groupFile = -1;
+	for (int counter = 0; counter < HardwareCounters; counter++)
+	{
+		profile.counterFiles[counter] = openCounter(configs[counter], groupFile);
+		if (groupFile == -1)
+		{
+			groupFile = profile.counterFiles[counter];
+		}
+	}
+	if (groupFile != -1)
+	{
+		ioctl(groupFile, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(groupFile, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+#endif
+	profile.startTime = chrono::steady_clock::now();
+	profile.startTicks = stageProfile::readTicks();
+}
+
+void stopProfile(stageProfile& profile)
+{
+	if (profile.active() == false)
+	{
+		return;
+	}
+	profile.totalTicks = stageProfile::readTicks() - profile.startTicks;
+	double nanoseconds = chrono::duration<double, nano>(chrono::steady_clock::now() - profile.startTime).count();
+	profile.nanosecondsPerTick = profile.totalTicks > 0 ? nanoseconds / profile.totalTicks : 0;
+#ifdef __linux__
+	//the first counter which could be opened leads the group
+	for (int counter = 0; counter < HardwareCounters; counter++)
+	{
+		if (profile.counterFiles[counter] != -1)
+		{
+			ioctl(profile.counterFiles[counter], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+			break;
+		}
+	}
+	for (int counter = 0; counter < HardwareCounters; counter++)
+	{
+		long long value = 0;
+		if (profile.counterFiles[counter] != -1)
+		{
+			if (read(profile.counterFiles[counter], &value, sizeof(value)) == sizeof(value))
+			{
+				profile.counters[counter] = value;
+			}
+			close(profile.counterFiles[counter]);
+			profile.counterFiles[counter] = -1;
+		}
+	}
+#endif
+}
+
+void printProfileReport(const stageProfile& profile, std::ostream& report)
+{
+	if (profile.active() == false)
+	{
+		return;
+	}
+	double total = profile.totalTicks * profile.nanosecondsPerTick;
+	unsigned long long stageTicks = 0;
+	report << "Profile: " << fixed << setprecision(3) << total / 1e6 << " ms in executeProgram()" << endl;
+	report << left << setw(14) << "stage" << right << setw(13) << "calls" << setw(10) << "ms" << setw(11) << "share"
+		<< setw(10) << "ns/call" << endl;
+	for (int stage = 0; stage <= ProfiledStages; stage++)
+	{
+		//the last line is the time spent out of the stage functions
+		unsigned long long ticks = 0;
+		if (stage < ProfiledStages)
+		{
+			ticks = profile.ticks[stage];
+			stageTicks += ticks;
+		}
+		else
+		{
+			ticks = profile.totalTicks > stageTicks ? profile.totalTicks - stageTicks : 0;
+		}
+		double nanoseconds = ticks * profile.nanosecondsPerTick;
+		report << left << setw(14) << (stage < ProfiledStages ? profiledStageNames[stage] : "other") << right
+			<< setw(13) << (stage < ProfiledStages ? to_string(profile.calls[stage]) : string("-"))
+			<< setw(10) << nanoseconds / 1e6 << setw(10) << (total > 0 ? nanoseconds * 100 / total : 0) << "%";
+		if (stage < ProfiledStages && profile.calls[stage] > 0)
+		{
+			report << setw(10) << nanoseconds / profile.calls[stage];
+		}
+		report << endl;
+	}
+	for (int counter = 0; counter < HardwareCounters; counter++)
+	{
+		report << hardwareCounterNames[counter] << ": ";
+		if (profile.counters[counter] < 0)
+		{
+			report << "not available" << endl;
+		}
+		else
+		{
+			report << profile.counters[counter] << endl;
+		}
+	}
+	report << defaultfloat;
+}
+
+void writeProfileJson(const stageProfile& profile, std::ostream& output)
+{
+	output << "{ \"seconds\" : " << profile.totalTicks * profile.nanosecondsPerTick / 1e9 << " , \"stages\" : [";
+	for (int stage = 0; stage < ProfiledStages; stage++)
+	{
+		output << "{ \"stage\" : \"" << profiledStageNames[stage] << "\" , \"calls\" : " << profile.calls[stage]
+			<< " , \"seconds\" : " << profile.ticks[stage] * profile.nanosecondsPerTick / 1e9 << " }";
+		if (stage != ProfiledStages - 1)
+		{
+			output << ", ";
+		}
+	}
+	output << "]";
+	for (int counter = 0; counter < HardwareCounters; counter++)
+	{
+		//null when the host cannot count it
+		output << " , \"" << hardwareCounterNames[counter] << "\" : ";
+		if (profile.counters[counter] < 0)
+		{
+			output << "null";
+		}
+		else
+		{
+			output << profile.counters[counter];
+		}
+	}
+	output << " }";
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "ostream"
+#include "chrono"
+
+#if defined(_MSC_VER)
+#include "intrin.h"
+#elif defined(__x86_64__) || defined(__i386__)
+#include "x86intrin.h"
+#endif
+
+//Profile of the host time spent in the pipeline stage functions of the simulator
+/** Every call of a stage function made by simulateCycle() is timed with the cycle counter of the processor, the time of
+	a stage includes the functions it calls (StallPipeline() calls ExecuteInstruction() for an instruction waiting for a
+	functional unit, that time is counted in ProfileStall). "other" is the rest of executeProgram(): the fetch and the
+	decoding of the trace, the walk over the active instructions, the skipped cycles of the event driven mode.
+	On Linux the hardware counters of the processor (instructions, cache misses, branch misses) are read with
+	perf_event_open for the whole of executeProgram(). They are not read per stage: reading them is a system call, it
+	would cost more than most stage calls. They are not available on every host (perf_event_paranoid, virtual machines).
+**/
+enum profiledStage { ProfileIssue, ProfileRead, ProfileExecute, ProfileWriteBack1, ProfileWriteBack2, ProfileStall, ProfiledStages };
+
+//name of each stage in the report and the output file
+extern const char* profiledStageNames[ProfiledStages];
+
+//Profiling compiled in. Build with TOMSIM_PROFILE=0 to remove it completely, like TOMSIM_MAX_LOG_LEVEL for the log
+#ifndef TOMSIM_PROFILE
+#define TOMSIM_PROFILE 1
+#endif
+
+enum hardwareCounter { CounterInstructions, CounterCacheMisses, CounterBranchMisses, HardwareCounters };
+
+extern const char* hardwareCounterNames[HardwareCounters];
+
+//Profile of one simulation, every simulator has its own
+struct stageProfile {
+	bool enabled = false; //run-time switch, only has an effect when TOMSIM_PROFILE is set
+	unsigned long long ticks[ProfiledStages] = {}; //cycle counter ticks spent in each stage
+	unsigned long long calls[ProfiledStages] = {};
+	unsigned long long totalTicks = 0; //of the whole executeProgram()
+	double nanosecondsPerTick = 0; //measured against the steady clock over the run
+	long long counters[HardwareCounters] = { -1, -1, -1 }; //-1 if the counter cannot be read on this host
+	int counterFiles[HardwareCounters] = { -1, -1, -1 }; //perf_event_open file descriptors while the run is profiled
+	unsigned long long startTicks = 0;
+	std::chrono::steady_clock::time_point startTime;
+
+	//returns true if the stage functions have to be timed
+	bool active() const
+	{
+		return TOMSIM_PROFILE && enabled;
+	}
+
+	//Time one call of a stage function
+	template <typename Call>
+	bool measure(int stage, Call call)
+	{
+		unsigned long long start = readTicks();
+		bool flag = call();
+		ticks[stage] += readTicks() - start;
+		calls[stage] += 1;
+		return flag;
+	}
+
+	static unsigned long long readTicks()
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+};
+
+//Call a stage function, timed when the profile is active: flag = PROFILE(ProfileRead, ReadOperands(i));
+//Uses the stageProfile named profileConfig in the current scope. Without profiling the call is made as it is
+#define PROFILE(stage, call) (profileConfig.active() ? profileConfig.measure(stage, [&]() { return call; }) : (call))
+
+//Start and stop the profile of a run: the total time, the calibration of the ticks and the hardware counters.
+//Nothing is done when the profile is not active
+void startProfile(stageProfile& profile);
+void stopProfile(stageProfile& profile);
+
+//Print the time of each stage, its share of the run and the hardware counters
+void printProfileReport(const stageProfile& profile, std::ostream& report);
+
+//Write the profile as the value of a JSON object member: { "seconds" : ... , "stages" : [...], ... }
+void writeProfileJson(const stageProfile& profile, std::ostream& output);
@@ -0,0 +1,552 @@
+#include "iostream"
+#include "string"
+#include "vector"
+#include "array"
+#include "cmath"
+#include "algorithm"
+
+#include "simulator.h"
+
+using namespace std;
+
+#define ConfidenceLevelZ 1.96 //normal quantile of the 95% confidence interval
+
+//Statistics counted over the measured unit of one sample
+struct sampleMeasurement {
+	long long cycles = 0;
+	std::array< long long, FUType > issued = {};
+	std::array< long long, FUType > registerReads = {};
+	std::array< std::vector<long long>, FUType > executed;
+	std::array< bool, FUType > saturated = {}; //the issue queue of the type never ran empty during the unit
+	std::array< double, FUType > queueLength = {}; //mean number of instructions waiting in the issue queue per cycle
+};
+
+//Part of a sampled run, either a sample simulated cycle by cycle or a fast forward
+struct runSegment {
+	bool simulated = false;
+	long long cycles = 0;
+	long long stalls = 0; //counted by the simulation of a sample
+	int sample = -1; //the sample of the period of the segment, a fast forward uses its issue rates
+	std::array< long long, FUType > arrivals = {}; //instructions fetched during the segment
+	std::array< long long, FUType > queueStart = {}; //instructions waiting in the issue queues when the segment starts
+	std::array< long long, FUType > queueEnd = {};
+};
+
+//Mean of the values and half width of its confidence interval, -1 if there are less than 2 values
+static void meanAndConfidence(const std::vector<double>& values, double& mean, double& confidence)
+{
+	int n = values.size();
+	mean = 0;
+	for (double value : values)
+	{
+		mean += value;
+	}
+	mean = n > 0 ? mean / n : 0;
+	if (n < 2)
+	{
+		confidence = -1;
+		return;
+	}
+	double variance = 0;
+	for (double value : values)
+	{
+		variance += (value - mean) * (value - mean);
+	}
+	variance /= n - 1;
+	confidence = ConfidenceLevelZ * std::sqrt(variance / n);
+}
+
+//Total of a quantity counted per instruction of a type, the instructions of each period times the ratio measured in
+//its sample; a period whose sample has no instruction of the type takes the mean ratio. The confidence interval uses the
+//successive difference variance of a systematic sample, -1 if less than 2 samples measured the ratio
+static sampledStatistic periodTotal(const std::vector<long long>& instructions, const std::vector<double>& ratio, const std::vector<bool>& measured)
+{
+	std::vector<double> ratios;
+	double differences = 0;
+	for (int j = 0; j < (int)ratio.size(); j++)
+	{
+		if (measured[j])
+		{
+			if (ratios.size() > 0)
+			{
+				differences += (ratio[j] - ratios.back()) * (ratio[j] - ratios.back());
+			}
+			ratios.push_back(ratio[j]);
+		}
+	}
+	double mean;
+	double confidence;
+	meanAndConfidence(ratios, mean, confidence);
+	sampledStatistic total;
+	double squares = 0;
+	for (int j = 0; j < (int)ratio.size(); j++)
+	{
+		total.estimate += instructions[j] * (measured[j] ? ratio[j] : mean);
+		squares += (double)instructions[j] * instructions[j];
+	}
+	if (squares == 0)
+	{
+		return total;
+	}
+	total.confidence = ratios.size() < 2 ? -1 : ConfidenceLevelZ * std::sqrt(differences / (2 * (ratios.size() - 1)) * squares);
+	return total;
+}
+
+//Issue rate of a type of FU in a sample, instructions per cycle, -1 if the type was not limited by its resources
+static double issueRate(const sampleMeasurement& sample, int typeFU)
+{
+	return sample.saturated[typeFU] ? (double)sample.issued[typeFU] / std::max(1LL, sample.cycles) : -1;
+}
+
+//Replay the run through a fluid model of the issue queues: a limited type issues at the rate of its sample, scaled by
+//(1 + scale * rateError[type]), the queue of the other types does not build up. The simulated samples are replayed as
+//they were simulated, shifted by the difference between the modelled queue and the simulated one.
+//At the end of the trace the queues are drained: an instruction ends 'tail' cycles after its issue, 'lastTail' is what
+//is left at the end of the trace of the tail of the last instruction fetched of the type
+static void replayQueues(const std::vector<runSegment>& segments, const std::vector<sampleMeasurement>& samples,
+	const std::array<double, FUType>& rateError, double scale, const std::array<int, FUType>& tail,
+	const std::array<int, FUType>& lastTail, double& cycles, double& stalls)
+{
+	std::array<double, FUType> waiting = {};
+	cycles = 0;
+	stalls = 0;
+	for (const runSegment& segment : segments)
+	{
+		cycles += segment.cycles;
+		if (segment.simulated)
+		{
+			stalls += segment.stalls;
+			for (int typeFU = 0; typeFU < FUType; typeFU++)
+			{
+				double offset = waiting[typeFU] - segment.queueStart[typeFU];
+				stalls += offset * segment.cycles;
+				waiting[typeFU] = std::max(0.0, segment.queueEnd[typeFU] + offset);
+			}
+			continue;
+		}
+		const sampleMeasurement& sample = samples[segment.sample];
+		for (int typeFU = 0; typeFU < FUType; typeFU++)
+		{
+			double rate = issueRate(sample, typeFU);
+			if (rate < 0)
+			{
+				stalls += sample.queueLength[typeFU] * segment.cycles;
+				waiting[typeFU] = 0;
+				continue;
+			}
+			rate *= 1 + scale * rateError[typeFU];
+			double growth = (double)segment.arrivals[typeFU] / segment.cycles - rate; //per cycle
+			double end = waiting[typeFU] + growth * segment.cycles;
+			if (end >= 0)
+			{
+				stalls += (waiting[typeFU] + end) / 2 * segment.cycles;
+				waiting[typeFU] = end;
+			}
+			else
+			{
+				//the queue runs empty during the segment
+				stalls += waiting[typeFU] * (waiting[typeFU] / -growth) / 2;
+				waiting[typeFU] = 0;
+			}
+		}
+	}
+	double drain = 0;
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		double rate = issueRate(samples.back(), typeFU);
+		if (waiting[typeFU] > 0 && rate > 0)
+		{
+			rate *= 1 + scale * rateError[typeFU];
+			double time = waiting[typeFU] / rate;
+			stalls += waiting[typeFU] * time / 2;
+			drain = std::max(drain, time + tail[typeFU]);
+		}
+		else
+		{
+			drain = std::max(drain, (double)lastTail[typeFU]);
+		}
+	}
+	cycles += drain;
+}
+
+//SMARTS style sampled simulation
+/** The trace is cut in periods of samplePeriod fetched instructions. Each period starts with a sample simulated cycle by
+	cycle: sampleWarmup instructions are issued to fill the reservation stations and functional units, then the next
+	sampleUnit issued instructions are measured. The rest of the period is fast forwarded: the active instructions are
+	dropped and the instructions are fetched one per cycle into the issue queues as usual, but they leave the queues
+	without being simulated. A type of FU whose queue never ran empty during the last sample is limited by its
+	reservation stations, its queue is drained at the issue rate measured in the sample; the queue of the other types is
+	drained as fast as it fills. The issue queues are the long term state of the machine (a trace fetched faster than it
+	executes builds up a backlog, which makes most of the stalls and the cycles after the last fetch), so they are warm
+	when the next sample starts.
+	The statistics are extrapolated per type of FU, the number of instructions of each type is known from the fetch:
+	- the instructions of each functional unit from its share of the instructions of its type in the samples
+	- the register reads from the reads per instruction of each type in the samples
+	- the cycles and stalls by a fluid model of the issue queues replayed over the whole run with the measured rates,
+	  its confidence interval is the one of the issue rates carried through the model
+	A trace which ends before the first fast forward is simulated completely, its statistics are exact.
+**/
+bool Simulator::executeSampled()
+{
+	if (sampleUnit <= 0 || sampleWarmup < 0)
+	{
+		cout << "Error: Invalid sample size" << endl;
+		return false;
+	}
+	long long CC = 1;
+	std::vector<sampleMeasurement> samples;
+	std::vector<runSegment> segments;
+	bool fastForwarded = false;
+	bool endOfTrace = false;
+	std::array<long long, FUType> lastFetch = {}; //cycle of the last instruction of each type which was not simulated
+
+	//counters of the statistics, the difference between two snapshots is what a unit measured
+	auto snapshot = [this](long long cycle, sampleMeasurement& measure)
+	{
+		measure.cycles = cycle;
+		measure.issued = issuedInstructions;
+		measure.registerReads = registerReadsOfType;
+		for (int typeFU = 0; typeFU < FUType; typeFU++)
+		{
+			measure.executed[typeFU].resize(FunctionalUnits[typeFU].size());
+			for (int i = 0; i < (int)FunctionalUnits[typeFU].size(); i++)
+			{
+				measure.executed[typeFU][i] = FunctionalUnits[typeFU][i].numberOfInstructionsExecuted;
+			}
+		}
+	};
+	auto totalIssued = [this]()
+	{
+		long long issued = 0;
+		for (int typeFU = 0; typeFU < FUType; typeFU++)
+		{
+			issued += issuedInstructions[typeFU];
+		}
+		return issued;
+	};
+
+	while (endOfTrace == false)
+	{
+		unsigned long long nextSample = inputInstructions.fetched + samplePeriod;
+
+		//Sample, cycle by cycle. Idle cycles are skipped like in the event driven mode, which also detects a deadlock
+		runSegment window;
+		window.simulated = true;
+		window.cycles = CC;
+		window.stalls = numberOfStructuralHazardStalls;
+		std::array<long long, FUType> issuedBefore = issuedInstructions;
+		for (int typeFU = 0; typeFU < FUType; typeFU++)
+		{
+			window.queueStart[typeFU] = issueQueues[typeFU].size();
+		}
+		sampleMeasurement start;
+		sampleMeasurement end;
+		long long warmedUp = totalIssued() + sampleWarmup;
+		long long measuredUntil = 0;
+		bool measuring = false;
+		bool measured = false;
+		std::array<bool, FUType> saturated;
+		std::array<long long, FUType> waitingCycles = {};
+		while (measured == false)
+		{
+			if (simulateCycle(CC) == false)
+			{
+				return false;
+			}
+			long long issued = totalIssued();
+			if (measuring == false && issued >= warmedUp)
+			{
+				measuring = true;
+				measuredUntil = issued + sampleUnit;
+				snapshot(CC, start);
+				saturated.fill(true);
+			}
+			else if (measuring)
+			{
+				for (int typeFU = 0; typeFU < FUType; typeFU++)
+				{
+					saturated[typeFU] = saturated[typeFU] && issueQueues[typeFU].size() > 0;
+					waitingCycles[typeFU] += issueQueues[typeFU].size();
+				}
+				if (issued >= measuredUntil)
+				{
+					snapshot(CC, end);
+					measured = true;
+				}
+			}
+			if (isDrained())
+			{
+				endOfTrace = true;
+				break;
+			}
+			CC += 1;
+			if (logConfig.enabled(LogDebug, CC))
+			{
+				printClockCycle(CC);
+			}
+			if (skipIdleCycles(CC) == false)
+			{
+				cout << "Problem in Current Clock Cycle" << endl;
+				return false;
+			}
+		}
+		if (endOfTrace && fastForwarded == false)
+		{
+			//nothing was skipped, the statistics are the ones of the complete simulation
+			totalNumberOfClockCycles = CC;
+			numberOfSamples = 0;
+			return true;
+		}
+		window.cycles = CC - window.cycles;
+		window.stalls = numberOfStructuralHazardStalls - window.stalls;
+		for (int typeFU = 0; typeFU < FUType; typeFU++)
+		{
+			window.queueEnd[typeFU] = issueQueues[typeFU].size();
+			window.arrivals[typeFU] = issuedInstructions[typeFU] - issuedBefore[typeFU] + window.queueEnd[typeFU] - window.queueStart[typeFU];
+			//the instructions still in the pipeline are dropped by the next fast forward
+			if (window.arrivals[typeFU] > 0 && endOfTrace == false)
+			{
+				lastFetch[typeFU] = CC - 1;
+			}
+		}
+		if (measured)
+		{
+			sampleMeasurement sample;
+			sample.cycles = end.cycles - start.cycles;
+			for (int typeFU = 0; typeFU < FUType; typeFU++)
+			{
+				sample.issued[typeFU] = end.issued[typeFU] - start.issued[typeFU];
+				sample.registerReads[typeFU] = end.registerReads[typeFU] - start.registerReads[typeFU];
+				sample.saturated[typeFU] = saturated[typeFU];
+				sample.queueLength[typeFU] = (double)waitingCycles[typeFU] / std::max(1LL, sample.cycles);
+				sample.executed[typeFU].resize(end.executed[typeFU].size());
+				for (int i = 0; i < (int)end.executed[typeFU].size(); i++)
+				{
+					sample.executed[typeFU][i] = end.executed[typeFU][i] - start.executed[typeFU][i];
+				}
+			}
+			samples.push_back(sample);
+		}
+		window.sample = samples.size() - 1;
+		segments.push_back(window);
+		if (endOfTrace || inputInstructions.fetched >= nextSample)
+		{
+			continue;
+		}
+
+		//Fast forward to the next sample, the issue queues drain at the rates of the last sample
+		const sampleMeasurement& rates = samples.back();
+		runSegment fastForward;
+		fastForward.sample = samples.size() - 1;
+		std::array<double, FUType> issueCredit = {};
+		resetPipeline();
+		fastForwarded = true;
+		for (int typeFU = 0; typeFU < FUType; typeFU++)
+		{
+			fastForward.queueStart[typeFU] = issueQueues[typeFU].size();
+		}
+		while (inputInstructions.fetched < nextSample)
+		{
+			queuedInstruction newInstruction;
+			bool available = false;
+			if (fetchInstruction(newInstruction.inst, available) == false)
+			{
+				cout << "Some problem in reading the trace. Aborting the execution.";
+				return false;
+			}
+			if (available == false)
+			{
+				endOfTrace = true;
+				break;
+			}
+			int typeFU = newInstruction.inst.functionalUnitType;
+			newInstruction.CCFetched = CC;
+			fastForward.arrivals[typeFU] += 1;
+			lastFetch[typeFU] = CC;
+			issueQueues[typeFU].push_back(newInstruction);
+			for (int typeFU = 0; typeFU < FUType; typeFU++)
+			{
+				std::deque<queuedInstruction>& waiting = issueQueues[typeFU];
+				double rate = issueRate(rates, typeFU);
+				if (rate < 0)
+				{
+					waiting.clear();
+					continue;
+				}
+				issueCredit[typeFU] += rate;
+				while (issueCredit[typeFU] >= 1 && waiting.size() > 0)
+				{
+					waiting.pop_front();
+					issueCredit[typeFU] -= 1;
+				}
+				if (waiting.size() == 0)
+				{
+					issueCredit[typeFU] = 0;
+				}
+			}
+			CC += 1;
+			fastForward.cycles += 1;
+		}
+		for (int typeFU = 0; typeFU < FUType; typeFU++)
+		{
+			fastForward.queueEnd[typeFU] = issueQueues[typeFU].size();
+		}
+		if (fastForward.cycles > 0)
+		{
+			segments.push_back(fastForward);
+		}
+	}
+
+	if (samples.empty())
+	{
+		cout << "Error: The trace ended before the first sample was measured" << endl;
+		return false;
+	}
+	numberOfSamples = samples.size();
+
+	//Instructions of each type fetched in each period, the period of a sample is its window and the fast forward after it
+	std::vector< std::array<long long, FUType> > periodInstructions(samples.size());
+	for (const runSegment& segment : segments)
+	{
+		for (int typeFU = 0; typeFU < FUType; typeFU++)
+		{
+			periodInstructions[segment.sample][typeFU] += segment.arrivals[typeFU];
+		}
+	}
+
+	//Instructions of each functional unit and register reads, extrapolated per type and per period
+	sampledRegisterReads = sampledStatistic();
+	double registerReadsVariance = 0;
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		std::vector<long long> instructions(samples.size());
+		std::vector<double> readsPerInstruction(samples.size());
+		std::vector<bool> measured(samples.size());
+		std::vector<long long> executed(samples.size());
+		for (int j = 0; j < (int)samples.size(); j++)
+		{
+			instructions[j] = periodInstructions[j][typeFU];
+			measured[j] = samples[j].issued[typeFU] > 0;
+			readsPerInstruction[j] = measured[j] ? (double)samples[j].registerReads[typeFU] / samples[j].issued[typeFU] : 0;
+			for (long long count : samples[j].executed[typeFU])
+			{
+				executed[j] += count;
+			}
+		}
+		sampledStatistic reads = periodTotal(instructions, readsPerInstruction, measured);
+		sampledRegisterReads.estimate += reads.estimate;
+		if (reads.confidence < 0 || sampledRegisterReads.confidence < 0)
+		{
+			sampledRegisterReads.confidence = -1;
+		}
+		else
+		{
+			registerReadsVariance += reads.confidence * reads.confidence;
+			sampledRegisterReads.confidence = std::sqrt(registerReadsVariance);
+		}
+
+		//share of the unit in the instructions of its type
+		sampledInstructions[typeFU].resize(FunctionalUnits[typeFU].size());
+		for (int i = 0; i < (int)FunctionalUnits[typeFU].size(); i++)
+		{
+			std::vector<double> share(samples.size());
+			for (int j = 0; j < (int)samples.size(); j++)
+			{
+				measured[j] = executed[j] > 0;
+				share[j] = measured[j] ? (double)samples[j].executed[typeFU][i] / executed[j] : 0;
+			}
+			sampledInstructions[typeFU][i] = periodTotal(instructions, share, measured);
+			FunctionalUnits[typeFU][i].numberOfInstructionsExecuted = std::llround(sampledInstructions[typeFU][i].estimate);
+		}
+	}
+
+	//Cycles and stalls from the queue model, with the issue rates at both ends of their confidence interval
+	std::array<double, FUType> rateError = {};
+	bool ratesKnown = true;
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		std::vector<double> rates;
+		for (const sampleMeasurement& sample : samples)
+		{
+			if (sample.saturated[typeFU])
+			{
+				rates.push_back(issueRate(sample, typeFU));
+			}
+		}
+		double mean;
+		double confidence;
+		meanAndConfidence(rates, mean, confidence);
+		if (rates.size() > 0)
+		{
+			ratesKnown = ratesKnown && confidence >= 0;
+			rateError[typeFU] = confidence >= 0 ? confidence / mean : 0;
+		}
+	}
+	//after its issue an instruction still reads its operands, executes and writes back. A trace which ends in a sample
+	//was simulated until the pipeline was drained, its last cycle is not counted in the segments yet
+	std::array<int, FUType> tail;
+	std::array<int, FUType> lastTail;
+	bool drained = segments.back().simulated;
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		tail[typeFU] = ClockCycles[typeFU] + 2;
+		lastTail[typeFU] = std::max(drained ? 1LL : 0LL, tail[typeFU] - (CC - 1 - lastFetch[typeFU]));
+	}
+	double cycles;
+	double stalls;
+	replayQueues(segments, samples, rateError, 0, tail, lastTail, cycles, stalls);
+	sampledCycles.estimate = cycles;
+	sampledStalls.estimate = stalls;
+	sampledCycles.confidence = 0;
+	sampledStalls.confidence = 0;
+	for (double scale : { -1.0, 1.0 })
+	{
+		replayQueues(segments, samples, rateError, scale, tail, lastTail, cycles, stalls);
+		sampledCycles.confidence = std::max(sampledCycles.confidence, std::abs(cycles - sampledCycles.estimate));
+		sampledStalls.confidence = std::max(sampledStalls.confidence, std::abs(stalls - sampledStalls.estimate));
+	}
+	if (ratesKnown == false)
+	{
+		sampledCycles.confidence = -1;
+		sampledStalls.confidence = -1;
+	}
+
+	totalNumberOfClockCycles = std::llround(sampledCycles.estimate);
+	numberOfOperandReadFromRegisterFile = std::llround(sampledRegisterReads.estimate);
+	numberOfStructuralHazardStalls = std::llround(sampledStalls.estimate);
+	return true;
+}
+
+//one line of the report: name, estimate and half width of the confidence interval
+static void printSampledStatistic(std::ostream& report, const std::string& name, const sampledStatistic& statistic)
+{
+	report << name << "\t" << std::llround(statistic.estimate) << "\t+- ";
+	if (statistic.confidence < 0)
+	{
+		report << "unknown" << endl;
+	}
+	else
+	{
+		report << std::llround(statistic.confidence) << " (" << (statistic.estimate > 0 ? 100 * statistic.confidence / statistic.estimate : 0) << "%)" << endl;
+	}
+}
+
+void Simulator::printSamplingReport(std::ostream& report)
+{
+	if (numberOfSamples == 0)
+	{
+		report << "Sampled simulation: the trace was simulated completely, the statistics are exact" << endl;
+		return;
+	}
+	report << "Sampled simulation: " << numberOfSamples << " samples of " << sampleUnit << " instructions, 95% confidence intervals" << endl;
+	printSampledStatistic(report, "cycles", sampledCycles);
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		for (int i = 0; i < (int)sampledInstructions[typeFU].size(); i++)
+		{
+			printSampledStatistic(report, std::string(functionalUnitNames[typeFU]) + " " + std::to_string(i), sampledInstructions[typeFU][i]);
+		}
+	}
+	printSampledStatistic(report, "reg reads", sampledRegisterReads);
+	printSampledStatistic(report, "stalls", sampledStalls);
+}
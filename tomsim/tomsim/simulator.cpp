@@ -0,0 +1,1812 @@
+#include "iostream"
+#include "fstream"
+#include "string"
+#include "vector"
+#include "array"
+#include "deque"
+#include "algorithm"
+#include "limits"
+#include "iterator"
+#ifdef _MSC_VER
+#include "intrin.h"
+#endif
+
+#include "simulator.h"
+#include "threadpool.h"
+
+using namespace std;
+
+//name of each type of FU, as in the configuration file
+const char* functionalUnitNames[FUType] = { "integer", "divider", "multiplier", "load", "store" };
+
+bool parseAllocationPolicy(const std::string& name, allocationPolicy& policy)
+{
+	if (name == "lowest")
+	{
+		policy = LowestIndex;
+	}
+	else if (name == "round-robin")
+	{
+		policy = RoundRobin;
+	}
+	else if (name == "lru")
+	{
+		policy = LeastRecentlyUsed;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+//index of the lowest set bit, word must not be 0
+static inline int countTrailingZeros(unsigned long long word)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return (int)index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanForward(&index, (unsigned long)word))
+	{
+		return (int)index;
+	}
+	_BitScanForward(&index, (unsigned long)(word >> 32));
+	return (int)index + 32;
+#else
+	return __builtin_ctzll(word);
+#endif
+}
+
+//All units of the list are available
+static void initializeFreeList(freeList& list, int count)
+{
+	list.freeUnits.assign((count + 63) / 64, 0);
+	list.releaseOrder.clear();
+	for (int i = 0; i < count; i++)
+	{
+		list.freeUnits[i / 64] |= 1ULL << (i % 64);
+		list.releaseOrder.push_back(i);
+	}
+	list.numberOfFree = count;
+	list.nextUnit = 0;
+}
+
+//lowest available unit with an index >= start, -1 if there is none
+static int findFreeUnit(const freeList& list, int start)
+{
+	int count = FreeListWords(list.freeUnits);
+	int word = start / 64;
+	if (word >= count)
+	{
+		return -1;
+	}
+	unsigned long long bits = list.freeUnits[word] & (~0ULL << (start % 64));
+	while (bits == 0)
+	{
+		word += 1;
+		if (word == count)
+		{
+			return -1;
+		}
+		bits = list.freeUnits[word];
+	}
+	return word * 64 + countTrailingZeros(bits);
+}
+
+//Take an available unit out of the list
+//returns the index of the unit, -1 if no unit is available
+static int allocateUnit(freeList& list, allocationPolicy policy)
+{
+	if (list.numberOfFree == 0)
+	{
+		return -1;
+	}
+	int unit;
+	if (policy == LeastRecentlyUsed)
+	{
+		unit = list.releaseOrder.front();
+		list.releaseOrder.pop_front();
+	}
+	else if (policy == RoundRobin)
+	{
+		unit = findFreeUnit(list, list.nextUnit);
+		if (unit == -1)
+		{
+			unit = findFreeUnit(list, 0);
+		}
+		list.nextUnit = unit + 1;
+	}
+	else
+	{
+		unit = findFreeUnit(list, 0);
+	}
+	list.freeUnits[unit / 64] &= ~(1ULL << (unit % 64));
+	list.numberOfFree -= 1;
+	return unit;
+}
+
+//Put a unit back in the list
+static void releaseUnit(freeList& list, int unit, allocationPolicy policy)
+{
+	list.freeUnits[unit / 64] |= 1ULL << (unit % 64);
+	list.numberOfFree += 1;
+	if (policy == LeastRecentlyUsed)
+	{
+		list.releaseOrder.push_back(unit);
+	}
+}
+
+//Make room for 'capacity' active instructions, the window is empty
+void Simulator::initializeWindow(int capacity)
+{
+	activeInstructions.slots.assign(capacity, instruction());
+	activeInstructions.inUse.assign(capacity, 0);
+	activeInstructions.freeSlots.clear();
+	for (int i = capacity - 1; i >= 0; i--)
+	{
+		activeInstructions.freeSlots.push_back(i);
+	}
+	activeInstructions.order.clear();
+	activeInstructions.order.reserve(capacity);
+	activeInstructions.nextOrder.clear();
+	activeInstructions.nextOrder.reserve(capacity);
+	activeInstructions.size = 0;
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		int count = ReservationStations[typeFU].size();
+		waitingStations[typeFU].waitingForOperands.assign((count + 63) / 64, 0);
+		waitingStations[typeFU].operandsReady.assign((count + 63) / 64, 0);
+		waitingStations[typeFU].slots.assign(count, NoSlot);
+		waitingStations[typeFU].functionalUnitWaiters.clear();
+	}
+	wokenSlots.clear();
+	pendingWakeUps = 0;
+	numberOfFunctionalUnitWaiters = 0;
+}
+
+//returns true if slot holds an active instruction
+bool Simulator::isActiveSlot(int slot) const
+{
+	return slot >= 0 && slot < (int)activeInstructions.inUse.size() && activeInstructions.inUse[slot] != 0;
+}
+
+//Add an instruction to the window, at its place in age order
+//returns the slot of the instruction, NoSlot if the window is full
+int Simulator::insertInstruction(const instruction& newInstruction)
+{
+	if (activeInstructions.freeSlots.empty())
+	{
+		return NoSlot;
+	}
+	int slot = activeInstructions.freeSlots.back();
+	activeInstructions.freeSlots.pop_back();
+	activeInstructions.slots[slot] = newInstruction;
+	activeInstructions.inUse[slot] = 1;
+	//the new instruction is usually the youngest one, the search starts from the young end
+	std::vector< int >& order = activeInstructions.order;
+	int position = order.size();
+	while (position > 0 && activeInstructions.slots[order[position - 1]].CCFetched > newInstruction.CCFetched)
+	{
+		position -= 1;
+	}
+	order.insert(order.begin() + position, slot);
+	activeInstructions.size += 1;
+	return slot;
+}
+
+//Remove an active instruction from the window, the other instructions keep their slot
+void Simulator::retireInstruction(int slot)
+{
+	activeInstructions.inUse[slot] = 0;
+	activeInstructions.freeSlots.push_back(slot);
+	activeInstructions.size -= 1;
+}
+
+//Take an instruction which entered the Wait stage out of the walk, see waitingInstructions
+void Simulator::parkInstruction(int slot)
+{
+	const instruction& current = activeInstructions.slots[slot];
+	waitingInstructions& waiting = waitingStations[current.FunctionalUnitType];
+	if (current.WaitCode == WaitingForOperand)
+	{
+		int RS = current.ReservationStation;
+		waiting.waitingForOperands[RS / 64] |= 1ULL << (RS % 64);
+		return;
+	}
+	//the instruction is usually the youngest waiter, the search starts from the young end
+	std::deque<int>& waiters = waiting.functionalUnitWaiters;
+	int position = waiters.size();
+	while (position > 0 && activeInstructions.slots[waiters[position - 1]].CCFetched > current.CCFetched)
+	{
+		position -= 1;
+	}
+	waiters.insert(waiters.begin() + position, slot);
+	numberOfFunctionalUnitWaiters += 1;
+}
+
+//Park the waiting instructions of 'order', after it has been restored from a checkpoint which lists every instruction
+void Simulator::parkWaitingInstructions()
+{
+	std::vector< int >& order = activeInstructions.order;
+	int kept = 0;
+	for (int k = 0; k < (int)order.size(); k++)
+	{
+		int i = order[k];
+		const instruction& current = activeInstructions.slots[i];
+		if (activeInstructions.inUse[i] != 0)
+		{
+			waitingStations[current.FunctionalUnitType].slots[current.ReservationStation] = i;
+			if (current.PipelineStage == Wait)
+			{
+				parkInstruction(i);
+				continue;
+			}
+		}
+		order[kept] = i;
+		kept += 1;
+	}
+	order.resize(kept);
+}
+
+//Age of the oldest instruction waiting for a functional unit of a type which has one available,
+//the largest long long if there is none
+long long Simulator::oldestWaiterAge() const
+{
+	long long age = std::numeric_limits<long long>::max();
+	for (int typeFU = 0; typeFU < FUType && numberOfFunctionalUnitWaiters > 0; typeFU++)
+	{
+		const std::deque<int>& waiters = waitingStations[typeFU].functionalUnitWaiters;
+		if (waiters.size() > 0 && freeFunctionalUnits[typeFU].numberOfFree > 0)
+		{
+			age = std::min(age, activeInstructions.slots[waiters.front()].CCFetched);
+		}
+	}
+	return age;
+}
+
+//Execute the instructions waiting for a functional unit which are older than 'olderThan' and get one, oldest first.
+//They are back in the walk, at the end of nextOrder
+//returns true if everything runs smoothly, else false
+bool Simulator::executeWaiters(long long olderThan, long long CC)
+{
+	while (true)
+	{
+		int oldest = -1;
+		long long age = olderThan;
+		for (int typeFU = 0; typeFU < FUType && numberOfFunctionalUnitWaiters > 0; typeFU++)
+		{
+			const std::deque<int>& waiters = waitingStations[typeFU].functionalUnitWaiters;
+			if (waiters.size() > 0 && freeFunctionalUnits[typeFU].numberOfFree > 0 &&
+				activeInstructions.slots[waiters.front()].CCFetched < age)
+			{
+				oldest = typeFU;
+				age = activeInstructions.slots[waiters.front()].CCFetched;
+			}
+		}
+		if (oldest == -1)
+		{
+			return true;
+		}
+		int slot = waitingStations[oldest].functionalUnitWaiters.front();
+		waitingStations[oldest].functionalUnitWaiters.pop_front();
+		numberOfFunctionalUnitWaiters -= 1;
+		if (PROFILE(ProfileStall, StallPipeline(slot, CC)) == false || activeInstructions.slots[slot].PipelineStage == Wait)
+		{
+			cout << "Problem in Current Clock Cycle" << endl;
+			return false;
+		}
+		activeInstructions.nextOrder.push_back(slot);
+	}
+}
+
+//Select the instructions whose operands were broadcast in this cycle, they go to the execute stage
+//returns true if everything runs smoothly, else false
+bool Simulator::wakeUpInstructions(long long CC)
+{
+	wokenSlots.clear();
+	for (int typeFU = 0; pendingWakeUps != 0; typeFU++, pendingWakeUps >>= 1)
+	{
+		if ((pendingWakeUps & 1) == 0)
+		{
+			continue;
+		}
+		waitingInstructions& waiting = waitingStations[typeFU];
+		int words = FreeListWords(waiting.operandsReady);
+		for (int word = 0; word < words; word++)
+		{
+			unsigned long long bits = waiting.operandsReady[word] & waiting.waitingForOperands[word];
+			waiting.operandsReady[word] = 0;
+			waiting.waitingForOperands[word] &= ~bits;
+			while (bits != 0)
+			{
+				int slot = waiting.slots[word * 64 + countTrailingZeros(bits)];
+				bits &= bits - 1;
+				if (PROFILE(ProfileStall, StallPipeline(slot, CC)) == false)
+				{
+					cout << "Problem in Current Clock Cycle" << endl;
+					return false;
+				}
+				wokenSlots.push_back(slot);
+			}
+		}
+	}
+	//back in the walk from the next cycle, at their place in age order. Usually a few instructions are woken up in a
+	//cycle and they are among the youngest ones, the search starts from the young end
+	std::vector< int >& order = activeInstructions.order;
+	for (int slot : wokenSlots)
+	{
+		int position = order.size();
+		order.push_back(slot);
+		while (position > 0 && activeInstructions.slots[order[position - 1]].CCFetched > activeInstructions.slots[slot].CCFetched)
+		{
+			order[position] = order[position - 1];
+			position -= 1;
+		}
+		order[position] = slot;
+	}
+	return true;
+}
+
+//Every active instruction in age order, with the waiting ones, as 'order' listed them before they were parked
+void Simulator::collectAgeOrder(std::vector<int>& slots) const
+{
+	std::vector<int> parked;
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		const waitingInstructions& waiting = waitingStations[typeFU];
+		for (int word = 0; word < (int)waiting.waitingForOperands.size(); word++)
+		{
+			for (unsigned long long bits = waiting.waitingForOperands[word]; bits != 0; bits &= bits - 1)
+			{
+				parked.push_back(waiting.slots[word * 64 + countTrailingZeros(bits)]);
+			}
+		}
+		parked.insert(parked.end(), waiting.functionalUnitWaiters.begin(), waiting.functionalUnitWaiters.end());
+	}
+	const std::vector< instruction >& window = activeInstructions.slots;
+	auto older = [&window](int a, int b) { return window[a].CCFetched < window[b].CCFetched; };
+	std::sort(parked.begin(), parked.end(), older);
+	slots.clear();
+	std::merge(activeInstructions.order.begin(), activeInstructions.order.end(), parked.begin(), parked.end(),
+		std::back_inserter(slots), older);
+}
+
+//Initialize the simulator
+Simulator::Simulator()
+{
+	for (int i = 0; i < NumberOfRegisters; i++)
+	{
+		registerResultStatus[i][0] = NoProducer;
+		registerResultStatus[i][1] = NoProducer;
+	}
+}
+
+Simulator::~Simulator()
+{
+	if (inputInstructions.binary.mapping != nullptr)
+	{
+		unmapBinaryTrace(inputInstructions.binary);
+	}
+}
+
+bool Simulator::readConfigFile(std::string fileName)
+{
+	string line;
+	ifstream configFile(fileName);
+	if (configFile.is_open())
+	{
+		while (getline(configFile, line))
+		{
+			if ((line.length() > 0) && line[0] != '#')
+			{
+				std::size_t start = line.find("\"") + 1;
+				std::size_t end = line.find("\":");
+				std::string key = line.substr(start, end - start);				
+				line = line.substr(end + 2);
+				start = line.find("\":") + 2;
+				end = line.find(",");
+				std::string value1 = line.substr(start, end - start);
+				line = line.substr(end+1);
+				start = line.find("\":") + 2;
+				end = line.find(",");
+				std::string value2 = line.substr(start, end - start);
+				line = line.substr(end);
+				start = line.find("\":") + 2;
+				end = line.find("}");
+				std::string value3 = line.substr(start, end - start);
+
+				//cout << key << "\t" << std::stoi(value1) << "\t" << std::stoi(value2) << "\t" << std::stoi(value3) << endl;
+				int index = -1;
+				if (key == "integer")
+				{
+					index = IntegerIndex;
+				}
+				else if (key == "divider")
+				{
+					index = DividerIndex;
+				}
+				else if (key == "multiplier")
+				{
+					index = MultiplierIndex;
+				}
+				else if (key == "load")
+				{
+					index = LoadIndex;
+				}
+				else if (key == "store")
+				{
+					index = StoreIndex;
+				}
+				else
+				{
+					cout << "Invalid key in configuration file: " << key << endl;
+					return false;
+				}
+				int FU = std::stoi(value1);
+				int RS = std::stoi(value2);
+				int CC = std::stoi(value3);
+				addFunctionalUnits(index, FU, RS, CC);
+			}
+		}
+		if (isCompiledMachine() == false)
+		{
+			return false;
+		}
+		finishConfiguration();
+		return true;
+	}
+	else
+	{
+		cout << "Cannot read the config file";
+		return false;
+	}
+}
+void Simulator::addFunctionalUnits(int typeFU, int numberOfUnits, int numberOfReservationStations, int latency)
+{
+	//Allocate FU
+	for (int i = 0; i < numberOfUnits; i++)
+	{
+		functionalUnit f;
+		FunctionalUnits[typeFU].push_back(f);
+	}
+
+	//Allocate Reservation Station
+	for (int i = 0; i < numberOfReservationStations; i++)
+	{
+		reservationStation r;
+		ReservationStations[typeFU].push_back(r);
+	}
+
+	ClockCycles[typeFU] = latency;
+}
+
+//returns true if the configuration is the machine the simulator was compiled for, always true in the generic build
+bool Simulator::isCompiledMachine() const
+{
+#ifdef TOMSIM_FIXED_MACHINE
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		if ((int)FunctionalUnits[typeFU].size() != FixedNumberOfUnits[typeFU] ||
+			(int)ReservationStations[typeFU].size() != FixedNumberOfReservationStations[typeFU] ||
+			ClockCycles[typeFU] != FixedLatency[typeFU])
+		{
+			cout << "The configuration file is not the machine of this simulator (built for " << FixedMachineName << "): "
+				<< functionalUnitNames[typeFU] << " has " << FunctionalUnits[typeFU].size() << " units, "
+				<< ReservationStations[typeFU].size() << " reservation stations, latency " << ClockCycles[typeFU]
+				<< " instead of " << FixedNumberOfUnits[typeFU] << " units, " << FixedNumberOfReservationStations[typeFU]
+				<< " reservation stations, latency " << FixedLatency[typeFU] << endl;
+			return false;
+		}
+	}
+#endif
+	return true;
+}
+
+void Simulator::finishConfiguration()
+{
+	int numberOfReservationStations = 0;
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		initializeFreeList(freeReservationStations[typeFU], ReservationStations[typeFU].size());
+		initializeFreeList(freeFunctionalUnits[typeFU], FunctionalUnits[typeFU].size());
+		numberOfReservationStations += ReservationStations[typeFU].size();
+	}
+	initializeWindow(numberOfReservationStations);
+}
+
+//Drop every active instruction: the reservation stations and functional units become available and every register is
+//in the register file. The issue queues and the statistics are kept
+void Simulator::resetPipeline()
+{
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		for (reservationStation& r : ReservationStations[typeFU])
+		{
+			r = reservationStation();
+		}
+		for (functionalUnit& f : FunctionalUnits[typeFU])
+		{
+			f.busy = false;
+		}
+		initializeFreeList(freeReservationStations[typeFU], ReservationStations[typeFU].size());
+		initializeFreeList(freeFunctionalUnits[typeFU], FunctionalUnits[typeFU].size());
+	}
+	for (int i = 0; i < NumberOfRegisters; i++)
+	{
+		registerResultStatus[i][0] = NoProducer;
+		registerResultStatus[i][1] = NoProducer;
+	}
+	initializeWindow(activeInstructions.slots.size());
+}
+
+//Decode the next block of the trace into the free part of the window
+//returns true if everything runs smoothly, else false
+bool Simulator::refillTraceWindow()
+{
+	while (inputInstructions.count < TraceWindowSize && !inputInstructions.endOfTrace)
+	{
+		if (inputInstructions.decodedPosition == inputInstructions.decoded.size())
+		{
+			inputInstructions.decodedPosition = 0;
+			if (inputInstructions.reader.decodeBlock(inputInstructions.decoded) == false)
+			{
+				return false;
+			}
+			if (inputInstructions.decoded.empty())
+			{
+				inputInstructions.endOfTrace = true;
+				if (inputInstructions.file.is_open())
+				{
+					inputInstructions.file.close();
+				}
+				if (inputInstructions.compressed.isOpen())
+				{
+					bool failed = inputInstructions.compressed.failed();
+					inputInstructions.compressed.close();
+					if (failed)
+					{
+						cout << "Error: The compressed trace is corrupt or truncated" << endl;
+						return false;
+					}
+				}
+				inputInstructions.decodeCache.commit();
+				break;
+			}
+			if (inputInstructions.decodeCache.isOpen())
+			{
+				inputInstructions.decodeCache.add(inputInstructions.decoded.data(), inputInstructions.decoded.size());
+			}
+		}
+		int tail = (inputInstructions.head + inputInstructions.count) % TraceWindowSize;
+		inputInstructions.window[tail] = inputInstructions.decoded[inputInstructions.decodedPosition];
+		inputInstructions.decodedPosition += 1;
+		inputInstructions.count += 1;
+	}
+	return true;
+}
+
+//Open the trace file. "-" reads the trace from the standard input, so a trace can be piped into the simulator, gzip
+//and zstd included.
+//Only the first block is decoded here, the rest is decoded on demand by fetchInstruction()
+//A binary trace is recognised by its magic and is mapped in memory instead, a gzip or zstd trace by its magic too.
+//A text trace found in the decode cache is mapped from the cache, else it is saved in the cache while it is decoded
+bool Simulator::readTraceFile(std::string fileName)
+{
+	inputInstructions.reader.numberOfThreads = decodeThreads > 0 ? decodeThreads : defaultNumberOfThreads();
+	if (fileName == "-")
+	{
+		if (openStandardInput(inputInstructions.reader, inputInstructions.compressed) == false)
+		{
+			return false;
+		}
+		return refillTraceWindow();
+	}
+	if (isBinaryTrace(fileName))
+	{
+		inputInstructions.endOfTrace = true;
+		return mapBinaryTrace(fileName, inputInstructions.binary);
+	}
+	std::string cacheEntry;
+	if (decodeCacheConfig.enabled && findDecodeCacheEntry(decodeCacheConfig, fileName, cacheEntry))
+	{
+		if (useDecodeCacheEntry(cacheEntry))
+		{
+			if (mapBinaryTrace(cacheEntry, inputInstructions.binary))
+			{
+				inputInstructions.endOfTrace = true;
+				return true;
+			}
+			cout << "The decode cache entry " << cacheEntry << " is not valid, the trace is decoded again" << endl;
+			removeDecodeCacheEntry(cacheEntry);
+		}
+		inputInstructions.decodeCache.open(decodeCacheConfig, cacheEntry);
+	}
+	traceCompression compression = compressionOf(fileName);
+	if (compression != NotCompressed)
+	{
+		if (inputInstructions.compressed.open(fileName, compression) == false)
+		{
+			return false;
+		}
+		inputInstructions.reader.input = &inputInstructions.compressed;
+		return refillTraceWindow();
+	}
+	inputInstructions.file.open(fileName);
+	if (inputInstructions.file.is_open())
+	{
+		inputInstructions.reader.input = &inputInstructions.file;
+		return refillTraceWindow();
+	}
+	else
+	{
+		cout << "Cannot read the input file";
+		return false;
+	}
+}
+
+void Simulator::useDecodedTrace(const decodedInstruction* instructions, unsigned long long instructionCount)
+{
+	//the records are fetched like the ones of a mapped binary trace, but the simulator does not own them
+	inputInstructions.endOfTrace = true;
+	inputInstructions.binary = mappedTrace();
+	inputInstructions.binary.instructions = instructions;
+	inputInstructions.binary.instructionCount = instructionCount;
+	inputInstructions.fetched = 0;
+}
+
+//Read the next instruction of the trace into inst without fetching it
+//'available' is set to false once the whole trace has been fetched
+//returns true if everything runs smoothly, else false
+bool Simulator::peekInstruction(decodedInstruction& inst, bool& available)
+{
+	if (inputInstructions.binary.instructions != nullptr)
+	{
+		available = inputInstructions.fetched < inputInstructions.binary.instructionCount;
+		if (available)
+		{
+			inst = inputInstructions.binary.instructions[inputInstructions.fetched];
+		}
+		return true;
+	}
+	if (inputInstructions.count == 0 && refillTraceWindow() == false)
+	{
+		return false;
+	}
+	available = inputInstructions.count > 0;
+	if (available)
+	{
+		inst = inputInstructions.window[inputInstructions.head];
+	}
+	return true;
+}
+
+//Fetch the next instruction of the trace into inst. In the check mode the functional model executes it, its outcome is
+//written to *expected if it is given
+//'available' is set to false once the whole trace has been fetched
+//returns true if everything runs smoothly, else false
+bool Simulator::fetchInstruction(decodedInstruction& inst, bool& available, instructionOutcome* expected)
+{
+	if (peekInstruction(inst, available) == false)
+	{
+		return false;
+	}
+	if (available)
+	{
+		inputInstructions.fetched += 1;
+		if (inputInstructions.fingerprinted)
+		{
+			inputInstructions.fingerprint = fingerprintInstruction(inputInstructions.fingerprint, inst);
+		}
+		if (inputInstructions.binary.instructions == nullptr)
+		{
+			inputInstructions.head = (inputInstructions.head + 1) % TraceWindowSize;
+			inputInstructions.count -= 1;
+		}
+		if (checkValues)
+		{
+			instructionOutcome outcome;
+			executeInstruction(functionalModel, inst, outcome);
+			if (expected != nullptr)
+			{
+				*expected = outcome;
+			}
+		}
+	}
+	return true;
+}
+
+
+//Print functions for debugging, they write to the log sink
+//Only the part of the trace which is already decoded into the window (or the next TraceWindowSize records of a binary trace) is printed
+void Simulator::printInputInstructions()
+{
+	std::ostream& out = *logConfig.sink;
+	int length = inputInstructions.count;
+	if (inputInstructions.binary.instructions != nullptr)
+	{
+		length = (int)std::min<unsigned long long>(TraceWindowSize, inputInstructions.binary.instructionCount - inputInstructions.fetched);
+	}
+	for (int k = 0; k < length; k++)
+	{
+		const decodedInstruction& currentInstruction = (inputInstructions.binary.instructions != nullptr) ?
+			inputInstructions.binary.instructions[inputInstructions.fetched + k] :
+			inputInstructions.window[(inputInstructions.head + k) % TraceWindowSize];
+		switch (currentInstruction.functionalUnitType)
+		{
+		case IntegerIndex:
+			out << "Integer" << "\t";
+			break;
+		case MultiplierIndex:
+			out << "Multiplier" << "\t";
+			break;
+		case DividerIndex:
+			out << "Divider" << "\t";
+			break;
+		case LoadIndex:
+			out << "Load" << "\t";
+			break;
+		case StoreIndex:
+			out << "Store" << "\t";
+			break;
+		}
+		if (currentInstruction.destination != NoRegister)
+		{
+			out << (int)currentInstruction.destination << "\t";
+		}
+		if (currentInstruction.source1 != NoRegister)
+		{
+			out << (int)currentInstruction.source1 << "\t";
+		}
+		if (currentInstruction.source2 != NoRegister)
+		{
+			out << (int)currentInstruction.source2 << "\t";
+		}
+		out << '\n';
+	}
+}
+
+void Simulator::printReservationStations()
+{
+	std::ostream& out = *logConfig.sink;
+	for (int i = 0; i < FUType; i++)
+	{
+		switch (i)
+		{
+		case IntegerIndex:
+			out << "Integer Reservation Stations" << ".............\n";
+			break;
+		case MultiplierIndex:
+			out << "Multiplier Reservation Stations" << ".............\n";
+			break;
+		case DividerIndex:
+			out << "Divider Reservation Stations" << ".......\n";
+			break;
+		case LoadIndex:
+			out << "Load Reservation Stations" << ".........\n";
+			break;
+		case StoreIndex:
+			out << "Store Reservation Stations" << "........\n";
+			break;
+		}
+		int count = ReservationStations[i].size();
+		for (int j = 0; j < count; j++)
+		{
+			out << "Reservation Station Number: " << j + 1 << '\n';
+			out << "Status: " << ReservationStations[i][j].busy << '\n';
+			if (ReservationStations[i][j].source1Ready)
+			{
+				out << "Source1 is ready " << '\n';
+			}
+			else
+			{
+				out << "Source1 is waiting for Functional Unit Index: " << ReservationStations[i][j].source1Producer[0] <<
+					" and Reservation Station: " << ReservationStations[i][j].source1Producer[1] << '\n';
+			}
+			if (ReservationStations[i][j].source2Ready)
+			{
+				out << "Source2 is ready " << '\n';
+			}
+			else
+			{
+				out << "Source2 is waiting for Functional Unit Index: " << ReservationStations[i][j].source2Producer[0] <<
+					" and Reservation Station: " << ReservationStations[i][j].source2Producer[1] << '\n';
+			}
+		}
+		out << '\n' << '\n';
+	}
+}
+
+void Simulator::printFunctionalUnits()
+{
+	std::ostream& out = *logConfig.sink;
+	for (int i = 0; i < FUType; i++)
+	{
+		switch (i)
+		{
+		case IntegerIndex:
+			out << "Integer FU" << ".............\n";
+			break;
+		case MultiplierIndex:
+			out << "Multiplier FU" << ".............\n";
+			break;
+		case DividerIndex:
+			out << "Divider FU" << ".......\n";
+			break;
+		case LoadIndex:
+			out << "Load FU" << ".........\n";
+			break;
+		case StoreIndex:
+			out << "Store FU" << "........\n";
+			break;
+		}
+		int count = FunctionalUnits[i].size();
+		for (int j = 0; j < count; j++)
+		{
+			out << "FU Number: " << j + 1 << '\n';
+			out << "Status: " << FunctionalUnits[i][j].busy << '\n';
+			if (FunctionalUnits[i][j].busy)
+			{
+				out << "RS using this FU: " << FunctionalUnits[i][j].reservationStationNumber << '\n';
+			}
+		}
+		out << '\n' << '\n';
+	}
+}
+
+void Simulator::printRegisterStatus()
+{
+	std::ostream& out = *logConfig.sink;
+	for (int i = 0; i < NumberOfRegisters; i++)
+	{
+		if (registerResultStatus[i][0] != NoProducer)
+		{
+			out << "Register No.: " << i << " depends on the functional unit type: " << registerResultStatus[i][0] << " Reservation Station: " << registerResultStatus[i][1] << '\n';
+		}
+	}
+}
+
+//State of the machine at the start of clock cycle CC
+void Simulator::printClockCycle(long long CC)
+{
+	*logConfig.sink << "Clock cycle " << CC << '\n';
+	if (logConfig.enabled(LogTrace, CC))
+	{
+		printInputInstructions();
+	}
+	printReservationStations();
+	printRegisterStatus();
+	printFunctionalUnits();
+}
+
+
+//Register the operand 'source' of reservation station (typeFU, RS) in the wait list of its producer
+void Simulator::addConsumer(int typeFU, int RS, int source, int producer[2])
+{
+	consumer waiting;
+	waiting.typeFU = typeFU;
+	waiting.RS = RS;
+	waiting.source = source;
+	ReservationStations[producer[0]][producer[1]].consumers.push_back(waiting);
+}
+
+//Make reservation station (typeFU, RS) the producer of register 'reg' in registerResultStatus
+void Simulator::setRegisterProducer(int reg, int typeFU, int RS)
+{
+	if (registerResultStatus[reg][0] != NoProducer)
+	{
+		//the register was produced by an older instruction, which does not own it anymore
+		ReservationStations[registerResultStatus[reg][0]][registerResultStatus[reg][1]].ownedRegisters &= ~(1 << reg);
+	}
+	registerResultStatus[reg][0] = typeFU;
+	registerResultStatus[reg][1] = RS;
+	ReservationStations[typeFU][RS].ownedRegisters |= 1 << reg;
+}
+
+// Functions to simulate each stage in pipeline
+//Function returns true if everything runs smoothly, else false
+//Issue the instructions waiting for a reservation station of type typeFU
+//The oldest waiting instructions take the available reservation stations, in the order of the reservation stations.
+//The issued instructions enter activeInstructions, they take part in the pipeline from the next cycle.
+bool Simulator::IssueInstruction( int typeFU, long long CC )
+{
+	std::deque<queuedInstruction>& waiting = issueQueues[typeFU];
+	//check if any reservation station of this type is available
+	while (waiting.size() > 0 && freeReservationStations[typeFU].numberOfFree > 0)
+	{
+		//Allocate Reservation Station
+		int i = allocateUnit(freeReservationStations[typeFU], LowestIndex);
+		ReservationStations[typeFU][i].busy = true;
+		instruction issued;
+		issued.inst = waiting.front().inst;
+		issued.expected = waiting.front().expected;
+		issued.CCFetched = waiting.front().CCFetched;
+		issued.FunctionalUnitType = typeFU;
+		issued.ReservationStation = i;
+		issued.PipelineStage = Read;
+		int slot = insertInstruction(issued);
+		if (slot == NoSlot)
+		{
+			cout << "Error: No slot left for an issued instruction" << endl;
+			return false;
+		}
+		waitingStations[typeFU].slots[i] = slot;
+		LOG(LogTrace, CC) << "cycle=" << CC << " event=issue fetched=" << waiting.front().CCFetched << " fu=" << functionalUnitNames[typeFU] << " rs=" << i << '\n';
+		waiting.pop_front();
+		issuedInstructions[typeFU] += 1;
+	}
+	//If no Reservation Station of required type is available, stall the instruction
+	numberOfStructuralHazardStalls += waiting.size();
+	return true;
+}
+
+bool Simulator::ReadOperands( int slot )
+{
+	//current instruction is in slot 'slot' of activeInstructions
+	if (isActiveSlot(slot) == false)
+	{
+		cout << "Error: Error while calling ReadOperands()" << endl;
+		return false;
+	}
+	instruction& currentInstruction = activeInstructions.slots[slot];
+	//check which type of Functional Unit is required by this instruction
+	int typeFU = currentInstruction.FunctionalUnitType;
+	//get the number of RS alloted to this instruction
+	int RS = currentInstruction.ReservationStation;
+	if (RS == -1)
+	{
+		cout << "Error: A reservation station must be assigned before reaching the Read stage" << endl;
+		return false;
+	}
+	//Update the reservation station status
+	ReservationStations[typeFU][RS].destination[0] = typeFU;
+	ReservationStations[typeFU][RS].destination[1] = RS;
+	const decodedInstruction& inst = currentInstruction.inst;
+	if (inst.format == RFormat) //Its a reg reg instruction with 3 registers // add, sub, and, nor, div, mul, mod, exp
+	{
+		int destinationRegister = inst.destination;
+		int source1 = inst.source1;
+		int source2 = inst.source2;
+		if (registerResultStatus[source1][0] != NoProducer) //source1 is destination of some active instruction
+		{
+			ReservationStations[typeFU][RS].source1Ready = false;
+			ReservationStations[typeFU][RS].source1Producer[0] = registerResultStatus[source1][0];
+			ReservationStations[typeFU][RS].source1Producer[1] = registerResultStatus[source1][1];
+			addConsumer(typeFU, RS, 1, ReservationStations[typeFU][RS].source1Producer);
+			//Since operand is not ready, the instruction should go in Wait stage
+			currentInstruction.PipelineStage = Wait;
+			currentInstruction.WaitCode = WaitingForOperand;
+		}
+		else
+		{
+			ReservationStations[typeFU][RS].source1Ready = true;
+			// We will read the value from register file
+			numberOfOperandReadFromRegisterFile += 1;
+		}
+		if (registerResultStatus[source2][0] != NoProducer) //source2 is destination of some active instruction
+		{
+			ReservationStations[typeFU][RS].source2Ready = false;
+			ReservationStations[typeFU][RS].source2Producer[0] = registerResultStatus[source2][0];
+			ReservationStations[typeFU][RS].source2Producer[1] = registerResultStatus[source2][1];
+			addConsumer(typeFU, RS, 2, ReservationStations[typeFU][RS].source2Producer);
+			//Since operand is not ready, the instruction should go in Wait stage
+			currentInstruction.PipelineStage = Wait;
+			currentInstruction.WaitCode = WaitingForOperand;
+		}
+		else
+		{
+			ReservationStations[typeFU][RS].source2Ready = true;
+			// We will read the value from register file
+			numberOfOperandReadFromRegisterFile += 1;
+		}
+		if (ReservationStations[typeFU][RS].source1Ready == true && ReservationStations[typeFU][RS].source2Ready == true)
+		{
+			//both the operands are ready, we can now go to execute stage
+			currentInstruction.PipelineStage = Execute;
+		}
+		setRegisterProducer(destinationRegister, typeFU, RS);
+	}
+	else if (inst.format == IFormat) //liz, lis
+	{
+		ReservationStations[typeFU][RS].source1Ready = true;
+		ReservationStations[typeFU][RS].source2Ready = true;
+		int destinationRegister = inst.destination;
+		setRegisterProducer(destinationRegister, typeFU, RS);
+		//both the operands are ready, we can now go to execute stage
+		currentInstruction.PipelineStage = Execute;
+	}
+	else if (inst.format == LoadFormat) //load $rd, $rs
+	{
+		ReservationStations[typeFU][RS].source2Ready = true;
+		int destinationRegister = inst.destination;
+		int source1 = inst.source1;
+		if (registerResultStatus[source1][0] != NoProducer) //source1 is destination of some active instruction
+		{
+			ReservationStations[typeFU][RS].source1Ready = false;
+			ReservationStations[typeFU][RS].source1Producer[0] = registerResultStatus[source1][0];
+			ReservationStations[typeFU][RS].source1Producer[1] = registerResultStatus[source1][1];
+			addConsumer(typeFU, RS, 1, ReservationStations[typeFU][RS].source1Producer);
+			//Since operand is not ready, the instruction should go in Wait stage
+			currentInstruction.PipelineStage = Wait;
+			currentInstruction.WaitCode = WaitingForOperand;
+		}
+		else
+		{
+			ReservationStations[typeFU][RS].source1Ready = true;
+			// We will read the value from register file
+			numberOfOperandReadFromRegisterFile += 1;
+			//both the operands are ready, we can now go to execute stage
+			currentInstruction.PipelineStage = Execute;
+		}
+		ReservationStations[typeFU][RS].source2Ready = true;
+		setRegisterProducer(destinationRegister, typeFU, RS);
+	}
+	else if (inst.format == StoreFormat) //store $rt,$rs
+	{
+		int source1 = inst.source1;
+		int source2 = inst.source2;
+		if (registerResultStatus[source1][0] != NoProducer) //source1 is destination of some active instruction
+		{
+			ReservationStations[typeFU][RS].source1Ready = false;
+			ReservationStations[typeFU][RS].source1Producer[0] = registerResultStatus[source1][0];
+			ReservationStations[typeFU][RS].source1Producer[1] = registerResultStatus[source1][1];
+			addConsumer(typeFU, RS, 1, ReservationStations[typeFU][RS].source1Producer);
+			//Since operand is not ready, the instruction should go in Wait stage
+			currentInstruction.PipelineStage = Wait;
+			currentInstruction.WaitCode = WaitingForOperand;
+		}
+		else
+		{
+			ReservationStations[typeFU][RS].source1Ready = true;
+			// We will read the value from register file
+			numberOfOperandReadFromRegisterFile += 1;
+		}
+		if (registerResultStatus[source2][0] != NoProducer) //source2 is destination of some active instruction
+		{
+			ReservationStations[typeFU][RS].source2Ready = false;
+			ReservationStations[typeFU][RS].source2Producer[0] = registerResultStatus[source2][0];
+			ReservationStations[typeFU][RS].source2Producer[1] = registerResultStatus[source2][1];
+			addConsumer(typeFU, RS, 2, ReservationStations[typeFU][RS].source2Producer);
+			//Since operand is not ready, the instruction should go in Wait stage
+			currentInstruction.PipelineStage = Wait;
+			currentInstruction.WaitCode = WaitingForOperand;
+		}
+		else
+		{
+			ReservationStations[typeFU][RS].source2Ready = true;
+			// We will read the value from register file
+			numberOfOperandReadFromRegisterFile += 1;
+		}
+		if (ReservationStations[typeFU][RS].source1Ready == true && ReservationStations[typeFU][RS].source2Ready == true)
+		{
+			//both the operands are ready, we can now go to execute stage
+			currentInstruction.PipelineStage = Execute;
+		}
+	}
+	else if (inst.format == HaltFormat) //halt
+	{
+		ReservationStations[typeFU][RS].source1Ready = true;
+		ReservationStations[typeFU][RS].source2Ready = true;
+		//both the operands are ready, we can now go to execute stage
+		currentInstruction.PipelineStage = Execute;
+	}
+	else if (inst.format == LuiFormat) // lui
+	{
+		int source1 = inst.source1;
+		if (registerResultStatus[source1][0] != NoProducer) //source1 is destination of some active instruction
+		{
+			ReservationStations[typeFU][RS].source1Ready = false;
+			ReservationStations[typeFU][RS].source1Producer[0] = registerResultStatus[source1][0];
+			ReservationStations[typeFU][RS].source1Producer[1] = registerResultStatus[source1][1];
+			addConsumer(typeFU, RS, 1, ReservationStations[typeFU][RS].source1Producer);
+			//Since operand is not ready, the instruction should go in Wait stage
+			currentInstruction.PipelineStage = Wait;
+			currentInstruction.WaitCode = WaitingForOperand;
+		}
+		else
+		{
+			ReservationStations[typeFU][RS].source1Ready = true;
+			// We will read the value from register file
+			numberOfOperandReadFromRegisterFile += 1;
+		}
+		ReservationStations[typeFU][RS].source2Ready = true;		
+		if (ReservationStations[typeFU][RS].source1Ready == true && ReservationStations[typeFU][RS].source2Ready == true)
+		{
+			//both the operands are ready, we can now go to execute stage
+			currentInstruction.PipelineStage = Execute;
+		}
+		int destinationRegister = inst.destination;
+		setRegisterProducer(destinationRegister, typeFU, RS);
+	}
+	else if (inst.format == PutFormat) // put
+	{
+		int source1 = inst.source1;
+		if (registerResultStatus[source1][0] != NoProducer) //source1 is destination of some active instruction
+		{
+			ReservationStations[typeFU][RS].source1Ready = false;
+			ReservationStations[typeFU][RS].source1Producer[0] = registerResultStatus[source1][0];
+			ReservationStations[typeFU][RS].source1Producer[1] = registerResultStatus[source1][1];
+			addConsumer(typeFU, RS, 1, ReservationStations[typeFU][RS].source1Producer);
+			//Since operand is not ready, the instruction should go in Wait stage
+			currentInstruction.PipelineStage = Wait;
+			currentInstruction.WaitCode = WaitingForOperand;
+		}
+		else
+		{
+			ReservationStations[typeFU][RS].source1Ready = true;
+			// We will read the value from register file
+			numberOfOperandReadFromRegisterFile += 1;
+			currentInstruction.PipelineStage = Execute;
+		}
+	}
+	else
+	{
+		cout << "Error: Some Problem in ReadOperand() function." << endl;
+		return false;
+	}
+	if (checkValues)
+	{
+		//the operands which are ready are in the register file, the others come with the broadcast of their producer
+		reservationStation& r = ReservationStations[typeFU][RS];
+		if (inst.source1 != NoRegister && r.source1Ready)
+		{
+			r.source1Value = registers[inst.source1];
+		}
+		if (inst.source2 != NoRegister && r.source2Ready)
+		{
+			r.source2Value = registers[inst.source2];
+		}
+	}
+	return true;
+}
+
+bool Simulator::ExecuteInstruction(int slot, long long CC)
+{
+	//current instruction is in slot 'slot' of activeInstructions
+	if (isActiveSlot(slot) == false)
+	{
+		cout << "Error: Error while calling ExecuteInstruction()" << endl;
+		return false;
+	}
+	instruction& currentInstruction = activeInstructions.slots[slot];
+	//check which type of Functional Unit is required by this instruction
+	int typeFU = currentInstruction.FunctionalUnitType;
+	//get the number of RS alloted to this instruction
+	int RS = currentInstruction.ReservationStation;
+	if (RS == -1)
+	{
+		cout << "Error: A reservation station must be assigned before reaching the Execute stage" << endl;
+		return false;
+	}
+	//get the number of FU alloted to this instruction
+	int FU = currentInstruction.FunctionalUnit;
+	if (FU == -1)
+	{
+		// no functional unit is assigned as of now
+		//check if there is an avialable functional unit
+		int i = allocateUnit(freeFunctionalUnits[typeFU], functionalUnitPolicy);
+		if (i != -1)
+		{
+			//we have found an avilable FU
+			currentInstruction.PipelineStage = Execute;
+			FunctionalUnits[typeFU][i].busy = true;
+			FunctionalUnits[typeFU][i].reservationStationNumber = RS;
+			FunctionalUnits[typeFU][i].numberOfInstructionsExecuted += 1;
+			currentInstruction.FunctionalUnit = i;
+			currentInstruction.CCExecutionStarted = CC; //execution started at this CC
+			LOG(LogTrace, CC) << "cycle=" << CC << " event=execute fetched=" << currentInstruction.CCFetched << " fu=" << functionalUnitNames[typeFU] << " rs=" << RS << " unit=" << i << '\n';
+		}
+		else
+		{
+			//there was no available Function Unit
+			currentInstruction.PipelineStage = Wait;
+			currentInstruction.WaitCode = WaitingForFunctionalUnit;
+			return true;
+		}
+	}
+	// we have a functional unit, execute the FU for this cycle
+	currentInstruction.CCpassed += 1;
+
+	//check if we complete execution after this cycle
+	if (currentInstruction.CCpassed == latency(typeFU))
+	{
+		// instruction have complete the execution, next stage is Write
+		currentInstruction.PipelineStage = Write;
+	}
+	//else the stage continued in execution stage
+	return true;
+}
+
+bool Simulator::WriteBackStage1(int slot)
+{
+	//current instruction is in slot 'slot' of activeInstructions
+	if (isActiveSlot(slot) == false)
+	{
+		cout << "Error: Error while calling WriteBackStage1()" << endl;
+		return false;
+	}
+	instruction& currentInstruction = activeInstructions.slots[slot];
+	//check which type of Functional Unit is required by this instruction
+	int typeFU = currentInstruction.FunctionalUnitType;
+	//get the number of RS alloted to this instruction
+	int RS = currentInstruction.ReservationStation;
+	if (RS == -1)
+	{
+		cout << "Error: A reservation station must be assigned before reaching the Write stage" << endl;
+		return false;
+	}
+	//get the number of FU alloted to this instruction
+	int FU = currentInstruction.FunctionalUnit;
+	if (FU == -1)
+	{
+		cout << "Error: A Function Unit must be assigned before reaching the Write stage" << endl;
+		return false;
+	}
+	//get the destination value for the current instruction
+	//this is the value that the current instruction has produced
+	int destFUType = ReservationStations[typeFU][RS].destination[0];
+	int destRS = ReservationStations[typeFU][RS].destination[1];
+	if (checkValues)
+	{
+		checkOutcome(slot);
+	}
+	signed short result = ReservationStations[destFUType][destRS].result;
+	//only the reservation stations in the wait list of the current one can require this produced value
+	//a consumer may have read the tag after an earlier instruction of this reservation station already broadcast it,
+	//in which case it waits for the next instruction using this reservation station
+	std::vector<consumer>& consumers = ReservationStations[destFUType][destRS].consumers;
+	int count = consumers.size();
+	for (int i = 0; i < count; i++)
+	{	
+		reservationStation& current = ReservationStations[consumers[i].typeFU][consumers[i].RS];
+		//check if its source1 is not ready and have producer same as current
+		if (consumers[i].source == 1 && current.source1Ready == false && current.source1Producer[0] == destFUType && current.source1Producer[1] == destRS)
+		{
+			current.source1Ready = true;
+			current.source1Value = result;
+		}
+		//check if its source2 is not ready and have producer same as current
+		if (consumers[i].source == 2 && current.source2Ready == false && current.source2Producer[0] == destFUType && current.source2Producer[1] == destRS)
+		{
+			current.source2Ready = true;
+			current.source2Value = result;
+		}
+		if (current.source1Ready && current.source2Ready)
+		{
+			waitingStations[consumers[i].typeFU].operandsReady[consumers[i].RS / 64] |= 1ULL << (consumers[i].RS % 64);
+			pendingWakeUps |= 1 << consumers[i].typeFU;
+		}
+	}
+	consumers.clear();
+	return true;
+}
+
+bool Simulator::WriteBackStage2(int slot)
+{
+	//current instruction is in slot 'slot' of activeInstructions
+	if (isActiveSlot(slot) == false)
+	{
+		cout << "Error: Error while calling WriteBackStage2()" << endl;
+		return false;
+	}
+	instruction& currentInstruction = activeInstructions.slots[slot];
+	//check which type of Functional Unit is required by this instruction
+	int typeFU = currentInstruction.FunctionalUnitType;
+	//get the number of RS alloted to this instruction
+	int RS = currentInstruction.ReservationStation;
+	if (RS == -1)
+	{
+		cout << "Error: A reservation station must be assigned before reaching the Write stage" << endl;
+		return false;
+	}
+	//get the number of FU alloted to this instruction
+	int FU = currentInstruction.FunctionalUnit;
+	if (FU == -1)
+	{
+		cout << "Error: A Function Unit must be assigned before reaching the Write stage" << endl;
+		return false;
+	}
+	//get the destination value for the current instruction
+	//this is the value that the current instruction has produced
+	int destFUType = ReservationStations[typeFU][RS].destination[0];
+	int destRS = ReservationStations[typeFU][RS].destination[1];
+
+	//clear the registers for which current RS is the producer in register Result Status
+	unsigned char ownedRegisters = ReservationStations[destFUType][destRS].ownedRegisters;
+	for (int i = 0; ownedRegisters != 0; i++, ownedRegisters >>= 1)
+	{
+		if (ownedRegisters & 1)
+		{
+			registerResultStatus[i][0] = NoProducer;
+			registerResultStatus[i][1] = NoProducer;
+			if (checkValues)
+			{
+				registers[i] = ReservationStations[destFUType][destRS].result;
+			}
+		}
+	}
+	ReservationStations[destFUType][destRS].ownedRegisters = 0;
+	if (checkValues && currentInstruction.inst.format == StoreFormat)
+	{
+		memory[(unsigned short)ReservationStations[typeFU][RS].source2Value] = ReservationStations[typeFU][RS].source1Value;
+	}
+	// release the functional unit
+	FunctionalUnits[typeFU][FU].busy = false;
+	releaseUnit(freeFunctionalUnits[typeFU], FU, functionalUnitPolicy);
+	// release the reservation station
+	ReservationStations[typeFU][RS].busy = false;
+	releaseUnit(freeReservationStations[typeFU], RS, LowestIndex);
+	//remove the current instruction from the active instruction list
+	retireInstruction(slot);
+	return true;
+}
+
+bool Simulator::StallPipeline(int slot, long long CC)
+{
+	//current instruction is in slot 'slot' of activeInstructions
+	if (isActiveSlot(slot) == false)
+	{
+		cout << "Error: Error while calling StalPipeline()" << endl;
+		return false;
+	}
+	instruction& currentInstruction = activeInstructions.slots[slot];
+	//check which type of Functional Unit is required by this instruction
+	int typeFU = currentInstruction.FunctionalUnitType;
+	bool flag = false;
+	int RS;
+	int WC = currentInstruction.WaitCode;
+	switch (WC)
+	{
+	case WaitingForOperand:
+		//get the number of RS alloted to this instruction
+		RS = currentInstruction.ReservationStation;
+		if (ReservationStations[typeFU][RS].source1Ready == true && ReservationStations[typeFU][RS].source2Ready == true)
+		{
+			//if both the operands are ready, then we can start executing the instruction in this clock cycle.
+			currentInstruction.PipelineStage = Execute;
+			//flag = ExecuteInstruction(slot, CC);
+			return true;
+		}
+		else
+		{
+			// operands are not ready yet, so we keep waiting
+			return true;
+		}
+	case WaitingForFunctionalUnit:
+		flag = ExecuteInstruction(slot, CC);
+		return flag;
+	default:
+		//instructions stalled on a structural hazard are in issueQueues
+		cout << "Error in StalPipeline(), unknown Wait Code" << endl;
+		return false;
+	}
+}
+
+//Skip the idle cycles starting at clock cycle CC. CC is moved to the next cycle which has to be simulated
+//returns true if everything runs smoothly, else false
+bool Simulator::skipIdleCycles(long long& CC)
+{
+	int nextCompletion = -1; //number of cycles until the first executing instruction completes, -1 if none is executing
+	//the waiting instructions are not in 'order', the ones which got their operands in this cycle are back in the execute stage
+	int count = activeInstructions.order.size();
+	for (int k = 0; k < count; k++)
+	{
+		int i = activeInstructions.order[k];
+		if (activeInstructions.inUse[i] == 0)
+		{
+			continue; //retired in this cycle
+		}
+		instruction& current = activeInstructions.slots[i];
+		int typeFU = current.FunctionalUnitType;
+		switch (current.PipelineStage)
+		{
+		case Execute:
+			if (current.FunctionalUnit == -1)
+			{
+				return true; //will try to get a functional unit in this cycle
+			}
+			if (current.CCpassed < latency(typeFU))
+			{
+				int remaining = latency(typeFU) - current.CCpassed;
+				if (nextCompletion == -1 || remaining < nextCompletion)
+				{
+					nextCompletion = remaining;
+				}
+			}
+			break;
+		default:
+			return true; //Read and Write always change the state
+		}
+	}
+	//resources are only released in the write back stage, so they stay as they are while the cycles are idle
+	std::array<bool, FUType> freeReservationStation = {};
+	int numberOfStructuralWaiters = 0;
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		freeReservationStation[typeFU] = freeReservationStations[typeFU].numberOfFree > 0;
+		if (issueQueues[typeFU].size() > 0 && freeReservationStation[typeFU])
+		{
+			return true;
+		}
+		numberOfStructuralWaiters += issueQueues[typeFU].size();
+		if (waitingStations[typeFU].functionalUnitWaiters.size() > 0 && freeFunctionalUnits[typeFU].numberOfFree > 0)
+		{
+			return true;
+		}
+	}
+
+	//The cycle in which an execution completes is simulated, the cycles before it can be skipped.
+	//A fetched instruction which finds no free reservation station stalls like the waiting ones
+	int skipped = 0;
+	while (nextCompletion == -1 || skipped < nextCompletion - 1)
+	{
+		queuedInstruction newInstruction;
+		bool available = false;
+		if (peekInstruction(newInstruction.inst, available) == false)
+		{
+			return false;
+		}
+		if (available)
+		{
+			if (freeReservationStation[newInstruction.inst.functionalUnitType])
+			{
+				break;
+			}
+			fetchInstruction(newInstruction.inst, available, &newInstruction.expected);
+			newInstruction.CCFetched = CC + skipped;
+			issueQueues[newInstruction.inst.functionalUnitType].push_back(newInstruction);
+			numberOfStructuralWaiters += 1;
+			numberOfStructuralHazardStalls += numberOfStructuralWaiters;
+		}
+		else if (nextCompletion == -1)
+		{
+			//nothing is executing and nothing can be issued anymore, the simulation would never end
+			cout << "Error: The pipeline is deadlocked at clock cycle " << CC + skipped << endl;
+			return false;
+		}
+		else
+		{
+			//the whole trace is fetched, jump directly to the next completion
+			numberOfStructuralHazardStalls += (long long)numberOfStructuralWaiters * (nextCompletion - 1 - skipped);
+			skipped = nextCompletion - 1;
+			break;
+		}
+		skipped += 1;
+	}
+	if (skipped == 0)
+	{
+		return true;
+	}
+	for (int k = 0; k < count; k++)
+	{
+		int i = activeInstructions.order[k];
+		if (activeInstructions.inUse[i] != 0 && activeInstructions.slots[i].PipelineStage == Execute)
+		{
+			activeInstructions.slots[i].CCpassed += skipped;
+		}
+	}
+	CC += skipped;
+	return true;
+}
+
+//The function to execute the program. It will call required pipeline stage and will manage all the instructions.
+//Simulate clock cycle CC: fetch, write back, read operands, execute, issue and release the resources
+//returns true if everything runs smoothly, else false
+bool Simulator::simulateCycle(long long CC)
+{
+	// Issue one new instruction in this CC
+	queuedInstruction newInstruction;
+	bool available = false;
+	if (fetchInstruction(newInstruction.inst, available, &newInstruction.expected) == false)
+	{
+		cout << "Some problem in reading the trace. Aborting the execution.";
+		return false;
+	}
+	if (available)
+	{
+		// there is atleast one in-active instruction
+		newInstruction.CCFetched = CC;
+
+		//the new instruction is the youngest one waiting for a reservation station
+		issueQueues[newInstruction.inst.functionalUnitType].push_back(newInstruction);
+	}
+
+	//Perioritize the instructions curently in Write stage over anything else.
+	//We check the entire activeInstruction queue and execute those instructions in order which are in Write stage
+	//The instructions retired in the previous cycle leave the age order here
+	writeBackSlots.clear();
+	std::vector< int >& order = activeInstructions.order;
+	int count = order.size();
+	int kept = 0;
+	for (int k = 0; k < count; k++)
+	{
+		int i = order[k];
+		if (activeInstructions.inUse[i] == 0)
+		{
+			continue;
+		}
+		order[kept] = i;
+		kept += 1;
+		if (activeInstructions.slots[i].PipelineStage == Write)
+		{
+			LOG(LogTrace, CC) << "cycle=" << CC << " event=write fetched=" << activeInstructions.slots[i].CCFetched << " fu=" << functionalUnitNames[activeInstructions.slots[i].FunctionalUnitType] << " rs=" << activeInstructions.slots[i].ReservationStation << '\n';
+			bool flag = PROFILE(ProfileWriteBack1, WriteBackStage1(i)); //broadcast the newly calculated values
+			if (flag == false)
+			{
+				cout << "Some problem in executing curent instruction. Aborting the execution.";
+				return false;
+			}
+			writeBackSlots.push_back(i);
+		}
+	}
+	order.resize(kept);
+	
+	// Execute one CC for all the active instructions
+	//The instructions waiting for a functional unit are not in 'order', the oldest ones which can get one are executed
+	//at their place in age order. An instruction which enters the Wait stage leaves 'order' (see waitingInstructions)
+	std::vector< int >& nextOrder = activeInstructions.nextOrder;
+	nextOrder.clear();
+	long long nextWaiterAge = oldestWaiterAge();
+	count = order.size();
+	for (int k = 0; k < count; k++)
+	{
+		int i = order[k];
+		if (nextWaiterAge < activeInstructions.slots[i].CCFetched)
+		{
+			if (executeWaiters(activeInstructions.slots[i].CCFetched, CC) == false)
+			{
+				return false;
+			}
+			nextWaiterAge = oldestWaiterAge();
+		}
+		int currentPipelineStage = activeInstructions.slots[i].PipelineStage;
+		bool flag = false;
+		switch (currentPipelineStage)
+		{
+		case Read:
+		{
+			//the register file reads are also counted per type of FU, the sampled simulation extrapolates them per type
+			long long reads = numberOfOperandReadFromRegisterFile;
+			flag = PROFILE(ProfileRead, ReadOperands(i));
+			registerReadsOfType[activeInstructions.slots[i].FunctionalUnitType] += numberOfOperandReadFromRegisterFile - reads;
+			break;
+		}
+		case Execute:
+			flag = PROFILE(ProfileExecute, ExecuteInstruction(i, CC));
+			break;
+		case Write:
+			flag = true;
+			break;
+		case Wait:
+			flag = PROFILE(ProfileStall, StallPipeline(i, CC));
+			break;
+		default:
+			cout << "Unknown PipeLine Stage" << endl;
+			break;
+		}
+		if (flag == false)
+		{
+			cout << "Problem in Current Clock Cycle" << endl;
+			return false;
+		}
+		if (activeInstructions.slots[i].PipelineStage == Wait)
+		{
+			parkInstruction(i);
+		}
+		else
+		{
+			nextOrder.push_back(i);
+		}
+	}
+	//the waiters which are younger than every instruction of the walk. When nextWaiterAge is the largest int, no
+	//waiter can get a functional unit: a waiter only joins the lists when no unit of its type is available anymore
+	if (nextWaiterAge != std::numeric_limits<long long>::max() && executeWaiters(std::numeric_limits<long long>::max(), CC) == false)
+	{
+		return false;
+	}
+	order.swap(nextOrder);
+	if (wakeUpInstructions(CC) == false)
+	{
+		return false;
+	}
+
+	//Issue stage. Reservation stations are only released at the end of the cycle, so the issue of one FU type does not
+	//depend on the other stages of this cycle
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		if (PROFILE(ProfileIssue, IssueInstruction(typeFU, CC)) == false)
+		{
+			cout << "Problem in Current Clock Cycle" << endl;
+			return false;
+		}
+	}
+
+	//Release the resources hold by the instruction in write stage at start of this CC
+	count = writeBackSlots.size();
+	for (int i = 0; i < count; i++)
+	{
+		bool flag = PROFILE(ProfileWriteBack2, WriteBackStage2(writeBackSlots[i]));
+		if (flag == false)
+		{
+			cout << "Some problem in executing curent instruction. Aborting the execution.";
+			return false;
+		}
+	}
+	return true;
+}
+
+//returns true if no instruction is active or waiting for a reservation station
+bool Simulator::isDrained() const
+{
+	bool waiting = false;
+	for (int typeFU = 0; typeFU < FUType; typeFU++)
+	{
+		waiting = waiting || issueQueues[typeFU].size() > 0;
+	}
+	return activeInstructions.size == 0 && waiting == false;
+}
+
+bool Simulator::executeProgram()
+{	
+	if (checkValues && (samplePeriod > 0 || firstCycle != 1))
+	{
+		cout << "Error: The check mode needs the simulation of the whole trace" << endl;
+		return false;
+	}
+	if (checkValues)
+	{
+		memory.assign(MemoryWords, 0);
+	}
+	startProfile(profileConfig);
+	bool flag = samplePeriod > 0 ? executeSampled() : executeCycles();
+	stopProfile(profileConfig);
+	return flag;
+}
+
+bool Simulator::executeCycles()
+{
+	long long CC = firstCycle;
+	bool checkpointPending = !checkpointFile.empty();
+	if (checkpointPending)
+	{
+		inputInstructions.fingerprinted = true;
+	}
+	if (CC != 1 && logConfig.enabled(LogDebug, CC))
+	{
+		//restored from a checkpoint, the state at the start of the first cycle was printed by the run it was taken from
+		printClockCycle(CC);
+	}
+	while (true)
+	{
+		//The checkpoint is the state at the start of the cycle, before the fetch
+		if (checkpointPending && ((checkpointCycle >= 0 && CC >= checkpointCycle) ||
+			(checkpointInstruction >= 0 && (long long)inputInstructions.fetched >= checkpointInstruction)))
+		{
+			checkpointPending = false;
+			if (writeCheckpoint(checkpointFile, CC) == false)
+			{
+				return false;
+			}
+		}
+
+		if (simulateCycle(CC) == false)
+		{
+			return false;
+		}
+
+		//each loop is one Clock Cycle
+		//We stop when there is no active instruction
+		if (isDrained())
+		{
+			break;
+		}
+		//Else we continue with a new clock cycle
+		CC += 1;
+
+		//for debugging, the state of the machine at the start of the new cycle
+		if (logConfig.enabled(LogDebug, CC))
+		{
+			printClockCycle(CC);
+		}
+
+		if (eventDriven && skipIdleCycles(CC) == false)
+		{
+			cout << "Problem in Current Clock Cycle" << endl;
+			return false;
+		}
+	}
+
+	//the trace ended before the cycle or the instruction asked for, there is no checkpoint file
+	if (checkpointPending)
+	{
+		cout << "Error: The simulation ended at clock cycle " << CC << " with " << inputInstructions.fetched <<
+			" instructions fetched, before the checkpoint" << endl;
+		return false;
+	}
+	totalNumberOfClockCycles = CC;
+	return true;
+}
+
+//Write the output file
+void Simulator::WriteOutputFile(std::string fileName)
+{
+	//Write the output file
+	ofstream outputStatFile;
+	outputStatFile.open(fileName);
+
+	//write register content
+	outputStatFile << "{\"cycles\":" << totalNumberOfClockCycles << " ," << endl;
+
+	outputStatFile << "\"integer\" : [";
+	int count = FunctionalUnits[IntegerIndex].size();
+	for (int i = 0; i < count; i++)
+	{
+		outputStatFile << "{ \"id\" : " << i << " , \"instructions\" : " << FunctionalUnits[IntegerIndex][i].numberOfInstructionsExecuted << " }";
+		if (i != count - 1)
+		{
+			outputStatFile << ", ";
+		}
+	}
+	outputStatFile << "]," << endl;
+
+	outputStatFile << "\"multiplier\" : [";
+	count = FunctionalUnits[MultiplierIndex].size();
+	for (int i = 0; i < count; i++)
+	{
+		outputStatFile << "{ \"id\" : " << i << " , \"instructions\" : " << FunctionalUnits[MultiplierIndex][i].numberOfInstructionsExecuted << " }";
+		if (i != count - 1)
+		{
+			outputStatFile << ", ";
+		}
+	}
+	outputStatFile << "]," << endl;
+
+	outputStatFile << "\"divider\" : [";
+	count = FunctionalUnits[DividerIndex].size();
+	for (int i = 0; i < count; i++)
+	{
+		outputStatFile << "{ \"id\" : " << i << " , \"instructions\" : " << FunctionalUnits[DividerIndex][i].numberOfInstructionsExecuted << " }";
+		if (i != count - 1)
+		{
+			outputStatFile << ", ";
+		}
+	}
+	outputStatFile << "]," << endl;
+
+	outputStatFile << "\"load\" : [";
+	count = FunctionalUnits[LoadIndex].size();
+	for (int i = 0; i < count; i++)
+	{
+		outputStatFile << "{ \"id\" : " << i << " , \"instructions\" : " << FunctionalUnits[LoadIndex][i].numberOfInstructionsExecuted << " }";
+		if (i != count - 1)
+		{
+			outputStatFile << ", ";
+		}
+	}
+	outputStatFile << "]," << endl;
+
+	outputStatFile << "\"store\" : [";
+	count = FunctionalUnits[StoreIndex].size();
+	for (int i = 0; i < count; i++)
+	{
+		outputStatFile << "{ \"id\" : " << i << " , \"instructions\" : " << FunctionalUnits[StoreIndex][i].numberOfInstructionsExecuted << " }";
+		if (i != count - 1)
+		{
+			outputStatFile << ", ";
+		}
+	}
+	outputStatFile << "]," << endl;
+
+	outputStatFile << "\"reg reads\" : " << numberOfOperandReadFromRegisterFile << " ," << endl;
+	outputStatFile << "\"stalls\" : " << numberOfStructuralHazardStalls;
+	if (profileConfig.active())
+	{
+		outputStatFile << " ," << endl << "\"profile\" : ";
+		writeProfileJson(profileConfig, outputStatFile);
+	}
+	outputStatFile << "}" << endl;
+	outputStatFile.close();
+}
+
@@ -0,0 +1,434 @@
+#pragma once
+
+#include "fstream"
+#include "string"
+#include "vector"
+#include "array"
+#include "deque"
+
+#include "trace.h"
+#include "log.h"
+#include "profile.h"
+#include "functional.h"
+#include "decompress.h"
+#include "decodecache.h"
+
+enum stage { Issue, Read, Execute, Write, Wait };
+enum stall { StructuralHazard, WaitingForOperand, WaitingForFunctionalUnit };
+
+//structure
+//A reservation station waiting for an operand, registered in the wait list of the reservation station producing it
+struct consumer {
+	int typeFU;
+	int RS;
+	int source; //1 or 2, which operand of the consumer is waiting
+};
+
+struct reservationStation {
+	bool busy = false;
+	bool source1Ready = false;
+	bool source2Ready = false;
+	//values, only carried in the check mode
+	signed short source1Value = 0;
+	signed short source2Value = 0;
+	signed short result = 0; //value computed by the instruction, set in the write back stage
+	int source1Producer[2] = { -1,-1 };
+	int source2Producer[2] = { -1, -1 };
+	int destination[2] = { -1, -1 };
+	//reservation stations waiting for the value this one produces, woken up by WriteBackStage1()
+	//the list belongs to the reservation station, not to the instruction: it is kept when the station is released
+	std::vector<consumer> consumers;
+	//bit i is set if register i has this reservation station as producer in registerResultStatus
+	unsigned char ownedRegisters = 0;
+};
+
+struct functionalUnit {
+	bool busy = false;
+	int reservationStationNumber;
+	long long numberOfInstructionsExecuted = 0;
+};
+
+struct instruction {
+	int PipelineStage;
+	int WaitCode = -1; //If instruction is in "WAIT" stage, then wait code tells why the instruction is waiting
+	int FunctionalUnitType; //index
+	int FunctionalUnit = -1; //the number of FU
+	int ReservationStation = -1; // the number of RS alloted to this instruction
+	int CCpassed = 0; //number of CC the current instruction has executed so far. When this number becomes equal to FU latency, the instruction has completed its execution
+	long long CCExecutionStarted = -1; //Clock cycle number when the execution stage started for this instruction
+	long long CCFetched = -1; //Clock cycle number when the instruction was fetched, one instruction is fetched per cycle so it also gives the age of the instruction
+	decodedInstruction inst; //program instruction
+	instructionOutcome expected; //check mode: outcome of the instruction in the functional model, set when it is fetched
+};
+
+//Instruction waiting in an issue queue. Until it gets a reservation station it has no stage, unit or cycle count, so only
+//what it gets when it is fetched is kept: 24 bytes instead of an instruction, the issue queues hold every instruction
+//fetched and not issued yet
+struct queuedInstruction {
+	long long CCFetched; //Clock cycle number when the instruction was fetched
+	decodedInstruction inst; //program instruction
+	instructionOutcome expected; //check mode: outcome of the instruction in the functional model
+};
+static_assert(sizeof(queuedInstruction) <= 24, "queuedInstruction must stay packed");
+
+//name of each type of FU, as in the configuration file
+extern const char* functionalUnitNames[FUType];
+
+//Free lists. One occupancy bitmap per FU type for the reservation stations and for the functional units, so finding an
+//available unit is a count trailing zeros instead of a scan of ReservationStations[typeFU] or FunctionalUnits[typeFU].
+//The busy flag of the units is kept up to date as well, it is what the print functions show.
+enum allocationPolicy { LowestIndex, RoundRobin, LeastRecentlyUsed };
+
+struct freeList {
+	std::vector<unsigned long long> freeUnits; //bit i of the bitmap is set if unit i is available
+	int numberOfFree = 0;
+	int nextUnit = 0; //RoundRobin: the search for an available unit starts here
+	std::deque<int> releaseOrder; //LeastRecentlyUsed: available units, the one released the longest time ago first
+};
+
+//Specialized build
+/** Built with TOMSIM_FIXED_MACHINE, the simulator only simulates the machine of fixedmachine.h, a header written by
+	tomsim-specialize from a configuration file (the tomsim-fixed project writes it from configuration.json before its
+	build). The latency of each type of FU is then a constant of the execute stage and, when every free list fits in one
+	64 bit word, the searches of the free lists and of the waiting sets are a single word. The statistics are the ones
+	of the generic build: readConfigFile() refuses a configuration file which does not describe the compiled machine.
+**/
+#ifdef TOMSIM_FIXED_MACHINE
+#include "fixedmachine.h"
+//words of a free list, a constant if every list of the machine fits in one word
+#define FreeListWords(list) (FixedFreeListWords == 1 ? 1 : (int)(list).size())
+#else
+#define FreeListWords(list) ((int)(list).size())
+#endif
+
+//Parse a policy name (lowest, round-robin, lru)
+//returns false if the name is unknown
+bool parseAllocationPolicy(const std::string& name, allocationPolicy& policy);
+
+#define NoProducer -1 //registerResultStatus entry of a register whose value is in the register file
+
+//The trace is not loaded as a whole. It is decoded block by block into a ring buffer (see traceStream below),
+//so the memory used by the front end depends on TraceWindowSize and not on the length of the trace.
+#define TraceWindowSize 4096 //Number of decoded instructions the front end keeps ahead of the pipeline
+
+//A binary trace (.tbin, see trace.h) is not decoded at all, the pipeline fetches its records from the mapped file.
+//A compressed text trace is decompressed on another thread while it is read, see decompress.h.
+//A text trace is decoded TraceTextBlockSize bytes at a time on several threads (see traceTextReader in trace.h), the
+//instructions of the block are moved into the window as it empties.
+struct traceStream {
+	std::ifstream file;
+	decompressingStream compressed;
+	traceTextReader reader; //reads &file, &compressed or &cin when the trace is read from a pipe
+	std::vector< decodedInstruction > decoded; //last block decoded by the reader, copied into the window as it empties
+	std::size_t decodedPosition = 0; //first instruction of 'decoded' not yet in the window
+	decodeCacheWriter decodeCache; //open while the instructions decoded are saved in the decode cache
+	bool endOfTrace = false; //true once the last line of the trace has been decoded
+	std::vector< decodedInstruction > window = std::vector< decodedInstruction >(TraceWindowSize); //ring buffer of decoded instructions
+	int head = 0; //position of the oldest decoded instruction in the window
+	int count = 0; //number of decoded instructions currently in the window
+	mappedTrace binary; //set when the trace is a binary trace
+	unsigned long long fetched = 0; //number of instructions fetched so far, for a binary trace the index of the next record
+	//hash of the instructions fetched so far, only kept up to date once 'fingerprinted' is set: it identifies the trace
+	//a checkpoint is taken with
+	bool fingerprinted = false;
+	unsigned long long fingerprint = TraceFingerprintSeed;
+};
+
+//Window of active instructions. The active instructions are the one which are currently in some stage in pipeline.
+//Each active instruction holds a reservation station, so the window has one slot per reservation station and never grows.
+//An instruction keeps its slot from issue to retirement, the slot number is its handle.
+//'order' lists the slots from the oldest to the youngest instruction. Retiring an instruction only clears the inUse flag
+//of its slot, nothing is moved; the retired slots are dropped from 'order' by the walk over the write stage at the start
+//of the next cycle. The instructions which only wait for operands or for a functional unit are not in 'order', see
+//waitingInstructions below.
+#define NoSlot -1 //no slot available
+
+struct instructionWindow {
+	std::vector< instruction > slots;
+	std::vector< unsigned char > inUse; //1 while the slot holds an active instruction
+	std::vector< int > freeSlots; //stack of the unused slots
+	std::vector< int > order; //slots in age order, may still hold slots retired in the current cycle
+	std::vector< int > nextOrder; //'order' of the next cycle, built by the walk over the stages
+	int size = 0; //number of active instructions
+};
+
+//Instructions which only wait, kept out of activeInstructions.order so the walks over the active instructions in every
+//cycle do not depend on the number of waiting instructions. One set per FU type, the bitsets have one bit per
+//reservation station like the free lists.
+/** An instruction waiting for its operands sets its bit in waitingForOperands. The broadcast which makes its last operand
+	ready sets its bit in operandsReady (WriteBackStage1()); the stations which are both waiting and ready are found with
+	a count trailing zeros per 64 stations at the end of the stage walk, and go to the execute stage in that cycle, as
+	if StallPipeline() had been called for them in the walk. They are back in 'order' from the next cycle.
+	An instruction waiting for a functional unit is in functionalUnitWaiters. While functional units of its type are
+	available, the oldest waiters are executed at their place in age order among the instructions of the walk, so the
+	functional units are still allocated to the oldest instructions first. The others would only count one more cycle
+	of waiting, they are not visited.
+**/
+struct waitingInstructions {
+	std::vector<unsigned long long> waitingForOperands; //bit RS is set if the instruction of reservation station RS waits for operands
+	std::vector<unsigned long long> operandsReady; //bit RS is set if both operands of reservation station RS are ready
+	std::vector<int> slots; //slot of the active instruction holding each reservation station
+	std::deque<int> functionalUnitWaiters; //slots of the instructions waiting for a functional unit, oldest first
+};
+
+//Checkpoint file: the state of a simulation at the start of a clock cycle
+/** header
+		char[8]: magic "TOMSIMCK"
+		uint32: version (CheckpointVersion)
+		uint32: functional unit allocation policy
+		int64: clock cycle
+		uint64: number of instructions fetched from the trace
+		uint64: fingerprint of these instructions (fingerprintInstruction() over each of them, from TraceFingerprintSeed)
+	followed by the configuration (number of reservation stations, number of functional units and latency of each type
+	of FU), the statistics, the registers and the register alias table, the reservation stations, the functional units,
+	their free lists, the window of active instructions and the issue queues, in this order. A vector is stored as its
+	number of elements followed by the elements, the active instructions as instruction records. The instructions
+	waiting in an issue queue are stored as their decodedInstruction record and the number of cycles since the previous
+	instruction of the queue was fetched (LEB128 varint).
+	The trace is not stored, restoring a checkpoint skips the instructions already fetched and checks their fingerprint.
+	Every tag, index and instruction read from the file is checked before the pipeline uses it.
+**/
+#define CheckpointMagic "TOMSIMCK"
+#define CheckpointVersion 4 //version 3 stores the stage and wait code of the instructions in the issue queues
+
+//Wrong value found by the check mode
+struct valueMismatch {
+	unsigned long long position; //of the instruction in the trace, from 0
+	unsigned char opcode;
+	signed short expected;
+	signed short value;
+	unsigned short expectedAddress; //of a load or store
+	unsigned short address;
+	bool memoryOrder; //a load with the right address
+};
+
+#define MaxReportedMismatches 10
+
+//Value of a statistic extrapolated from the samples of a sampled simulation
+struct sampledStatistic {
+	double estimate = 0;
+	double confidence = 0; //half width of the 95% confidence interval, -1 if there are not enough samples to know it
+};
+
+//One simulation: the machine built from a configuration file running one trace.
+//All the state of the simulation is in the object, nothing is shared between two simulators, so several simulators can
+//run at the same time on different threads.
+/** Simulator simulator;
+	simulator.readConfigFile(configFile);
+	simulator.readTraceFile(traceFile);
+	simulator.executeProgram();
+	simulator.WriteOutputFile(outputFile);
+**/
+class Simulator {
+public:
+	Simulator();
+	~Simulator();
+	Simulator(const Simulator&) = delete;
+	Simulator& operator=(const Simulator&) = delete;
+
+	//Build the reservation stations and functional units described by the config file
+	//returns true if the file is read properly
+	bool readConfigFile(std::string fileName);
+
+	//Build the machine without a config file: add the units of each type like the lines of the config file do,
+	//then call finishConfiguration() once
+	void addFunctionalUnits(int typeFU, int numberOfUnits, int numberOfReservationStations, int latency);
+	void finishConfiguration();
+
+	//Open the trace file. "-" reads the trace from the standard input, so a trace can be piped into the simulator.
+	//Only the first block is decoded here, the rest is decoded on demand by fetchInstruction()
+	//A binary trace is recognised by its magic and is mapped in memory instead
+	bool readTraceFile(std::string fileName);
+
+	//Run the trace already decoded in memory instead of a trace file. The instructions are only read, several
+	//simulators can share them; they must stay valid until the simulator is destroyed
+	void useDecodedTrace(const decodedInstruction* instructions, unsigned long long instructionCount);
+
+	//Restore the state saved in a checkpoint file. Call it after readConfigFile() and readTraceFile(), with the
+	//configuration and the trace of the simulation the checkpoint was taken from; executeProgram() then goes on from
+	//the cycle of the checkpoint
+	//returns true if the checkpoint is read properly
+	bool restoreCheckpoint(const std::string& fileName);
+
+	//The function to execute the program. It will call required pipeline stage and will manage all the instructions.
+	bool executeProgram();
+
+	//Print the extrapolated statistics of a sampled simulation and their confidence intervals
+	void printSamplingReport(std::ostream& report);
+
+	//Print the wrong values found by the check mode and compare the final state with the functional model
+	void printCheckReport(std::ostream& report);
+
+	//Write the statistics of the simulation in the output file
+	void WriteOutputFile(std::string fileName);
+
+	//Print functions for debugging, they write to the log sink
+	void printInputInstructions();
+	void printReservationStations();
+	void printFunctionalUnits();
+	void printRegisterStatus();
+
+	//Options, set them before executeProgram()
+
+	//Event driven mode
+	//In a cycle where no instruction can change its stage, the only work done is counting: executing instructions move one
+	//cycle closer to their latency, and every instruction waiting for a reservation station counts one more stall.
+	//skipIdleCycles() finds the next cycle in which some state can change (an execution completes, a reservation station
+	//or functional unit becomes available for a waiting instruction, an operand is ready, or a fetched instruction finds a
+	//free reservation station) and applies the skipped cycles in one step. The statistics are the same as cycle by cycle.
+	bool eventDriven = false;
+
+	//Policy used to choose among the available functional units, it decides how the instructions are distributed among the
+	//FUs of one type. Reservation stations are always allocated lowest index first.
+	allocationPolicy functionalUnitPolicy = LowestIndex;
+
+	//Checkpoint: the state is written to checkpointFile at the start of the first cycle which is at least
+	//checkpointCycle, or in which at least checkpointInstruction instructions have been fetched (-1: not used).
+	//The simulation then goes on
+	std::string checkpointFile;
+	long long checkpointCycle = -1;
+	long long checkpointInstruction = -1;
+
+	//Sampled simulation
+	//Only a sample of the trace is simulated cycle by cycle: every samplePeriod instructions, sampleWarmup instructions
+	//are issued to fill the pipeline and the next sampleUnit ones are measured. The rest of the trace is fast forwarded,
+	//it only goes through the issue queues at the rate of the last sample. The statistics are extrapolated from the
+	//measured units, see executeSampled(). 0: every cycle is simulated
+	int samplePeriod = 0;
+	int sampleUnit = 1000;
+	int sampleWarmup = 2000;
+
+	//Check mode
+	//The timing model carries the values of the instructions: an operand is read from the register file or comes with
+	//the broadcast of its producer, a load reads the memory at the end of its execution and a store writes it in the
+	//write back stage. The functional model executes each instruction in program order when it is fetched, and every
+	//value the timing model produces is compared with it. A wrong value is counted and replaced by the right one, so
+	//the instructions using it are checked on their own. The timing model has no ordering of the memory accesses, a
+	//load or store with the right address and the wrong value is counted apart.
+	//Only for a simulation of the whole trace from the first cycle, one instruction is fetched per cycle so the
+	//instruction fetched in cycle CC is the instruction CC - 1 of the trace
+	bool checkValues = false;
+
+	logSettings logConfig;
+
+	//Profile of the host time spent in each stage function, see profile.h
+	stageProfile profileConfig;
+
+	//Decode cache of the text traces, see decodecache.h. Set it before readTraceFile()
+	decodeCacheSettings decodeCacheConfig;
+
+	//Number of threads decoding a text trace, 0 for one per hardware thread. Set it before readTraceFile()
+	int decodeThreads = 0;
+
+	//Statistics
+	long long numberOfStructuralHazardStalls = 0; //one per waiting instruction per cycle, overflows an int on long traces
+	long long totalNumberOfClockCycles = 0;
+	long long numberOfOperandReadFromRegisterFile = 0;
+
+	//array of reservation_station
+	std::array< std::vector<reservationStation> , FUType> ReservationStations;
+
+	//array of functional unit
+	std::array< std::vector<functionalUnit> , FUType> FunctionalUnits;
+
+	//array of clock cycles
+	int ClockCycles[FUType] = {};
+
+	//latency of the type of FU in the pipeline stages, the compiled one in the specialized build
+	int latency(int typeFU) const
+	{
+#ifdef TOMSIM_FIXED_MACHINE
+		return FixedLatency[typeFU];
+#else
+		return ClockCycles[typeFU];
+#endif
+	}
+
+	//Statistics of a sampled simulation, the statistics above are set to their estimates
+	int numberOfSamples = 0; //0 if the trace was simulated completely, the statistics are exact
+	sampledStatistic sampledCycles;
+	sampledStatistic sampledRegisterReads;
+	sampledStatistic sampledStalls;
+	std::array< std::vector<sampledStatistic>, FUType> sampledInstructions; //one per functional unit
+
+	//Statistics of the check mode
+	long long checkedInstructions = 0;
+	long long memoryOrderMismatches = 0;
+	long long dataflowMismatches = 0; //every other wrong value
+	std::vector<valueMismatch> firstMismatches; //the first MaxReportedMismatches
+
+private:
+	std::array< freeList, FUType > freeReservationStations;
+	std::array< freeList, FUType > freeFunctionalUnits;
+
+	//16 bit registers
+	signed short registers[NumberOfRegisters] = { 0 };
+
+	//Register alias table. Index: register_Number Value: [type of functional unit, reservation station number]
+	//[NoProducer, NoProducer] if no active instruction writes the register. The whole table fits in one cache line.
+	alignas(64) std::array< std::array<int,2>, NumberOfRegisters > registerResultStatus;
+
+	traceStream inputInstructions;
+
+	long long firstCycle = 1; //clock cycle executeProgram() starts with, the cycle of the checkpoint once one is restored
+
+	instructionWindow activeInstructions;
+	std::array< waitingInstructions, FUType > waitingStations;
+	std::vector<int> wokenSlots; //instructions which got their operands in the current cycle
+	int pendingWakeUps = 0; //bit typeFU is set if operandsReady bits of the type were set in the current cycle
+	int numberOfFunctionalUnitWaiters = 0; //of all the types
+	std::vector<int> writeBackSlots; //slots of the instructions in write stage in the current cycle, oldest first
+
+	//Instructions waiting for a reservation station, one queue per type of FU, oldest first.
+	//They are kept out of activeInstructions: until a reservation station of their type is released, the only thing a
+	//waiting instruction does in a cycle is counting one structural hazard stall, so they are handled per FU type.
+	std::array< std::deque<queuedInstruction>, FUType > issueQueues;
+	std::array< long long, FUType > issuedInstructions = {}; //number of instructions which got a reservation station
+	std::array< long long, FUType > registerReadsOfType = {}; //numberOfOperandReadFromRegisterFile per type of FU
+
+	//Check mode
+	architecturalState functionalModel; //state after the last fetched instruction
+	std::vector<signed short> memory; //data memory of the timing model
+
+	bool isCompiledMachine() const;
+	void initializeWindow(int capacity);
+	bool isActiveSlot(int slot) const;
+	int insertInstruction(const instruction& newInstruction);
+	void retireInstruction(int slot);
+	void parkInstruction(int slot);
+	void parkWaitingInstructions();
+	long long oldestWaiterAge() const;
+	bool executeWaiters(long long olderThan, long long CC);
+	bool wakeUpInstructions(long long CC);
+	void collectAgeOrder(std::vector<int>& slots) const;
+
+	bool refillTraceWindow();
+	bool peekInstruction(decodedInstruction& inst, bool& available);
+	bool fetchInstruction(decodedInstruction& inst, bool& available, instructionOutcome* expected = nullptr);
+
+	void addConsumer(int typeFU, int RS, int source, int producer[2]);
+	void setRegisterProducer(int reg, int typeFU, int RS);
+
+	// Functions to simulate each stage in pipeline
+	//Function returns true if everything runs smoothly, else false
+	bool IssueInstruction(int typeFU, long long CC);
+	bool ReadOperands(int slot);
+	bool ExecuteInstruction(int slot, long long CC);
+	bool WriteBackStage1(int slot);
+	bool WriteBackStage2(int slot);
+	bool StallPipeline(int slot, long long CC);
+
+	bool simulateCycle(long long CC);
+	bool executeCycles(); //the whole trace, cycle by cycle or event driven
+	bool isDrained() const;
+	bool skipIdleCycles(long long& CC);
+	void resetPipeline();
+	bool executeSampled();
+
+	void checkOutcome(int slot); //compute and check the value of an instruction which completed its execution
+
+	void printClockCycle(long long CC); //the print functions under a "Clock cycle" header
+
+	//returns true if the checkpoint is written properly
+	bool writeCheckpoint(const std::string& fileName, long long CC);
+};
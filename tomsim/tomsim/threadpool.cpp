@@ -0,0 +1,82 @@
+#include "thread"
+#include "mutex"
+#include "deque"
+#include "algorithm"
+
+#include "threadpool.h"
+
+using namespace std;
+
+//Jobs of one worker. The owner takes from the front, the other workers steal from the back
+struct workerQueue {
+	std::mutex lock;
+	std::deque<int> jobs;
+};
+
+int defaultNumberOfThreads()
+{
+	int count = std::thread::hardware_concurrency();
+	return count > 0 ? count : 1;
+}
+
+//Take the next job of worker 'self', stealing one if its own queue is empty
+//returns false once there is no job left anywhere
+static bool takeJob(std::vector<workerQueue>& queues, int self, int& job)
+{
+	{
+		std::lock_guard<std::mutex> guard(queues[self].lock);
+		if (!queues[self].jobs.empty())
+		{
+			job = queues[self].jobs.front();
+			queues[self].jobs.pop_front();
+			return true;
+		}
+	}
+	int count = queues.size();
+	for (int i = 1; i < count; i++)
+	{
+		workerQueue& victim = queues[(self + i) % count];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.jobs.empty())
+		{
+			job = victim.jobs.back();
+			victim.jobs.pop_back();
+			return true;
+		}
+	}
+	//jobs are never added once the workers run, so empty queues stay empty
+	return false;
+}
+
+void runJobs(const std::vector<int>& jobs, int numberOfThreads, const std::function<void(int)>& job)
+{
+	if (numberOfThreads < 1)
+	{
+		numberOfThreads = 1;
+	}
+	if (numberOfThreads > (int)jobs.size())
+	{
+		numberOfThreads = std::max<int>(1, jobs.size());
+	}
+	std::vector<workerQueue> queues(numberOfThreads);
+	for (int i = 0; i < (int)jobs.size(); i++)
+	{
+		queues[i % numberOfThreads].jobs.push_back(jobs[i]);
+	}
+	std::vector<std::thread> workers;
+	for (int self = 0; self < numberOfThreads; self++)
+	{
+		workers.push_back(std::thread([&queues, &job, self]()
+		{
+			int next;
+			while (takeJob(queues, self, next))
+			{
+				job(next);
+			}
+		}));
+	}
+	for (int i = 0; i < numberOfThreads; i++)
+	{
+		workers[i].join();
+	}
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "functional"
+#include "vector"
+
+//Number of threads used when the user does not choose: one per hardware thread
+int defaultNumberOfThreads();
+
+//Run job(j) for every j of 'jobs' on numberOfThreads threads, returns once all of them are done
+//The jobs are dealt round robin to the workers in the order of 'jobs'. Every worker runs its own jobs front to back;
+//a worker with nothing left steals from the back of the queue of another worker, so the jobs given first still
+//start first and the workers stay busy when the jobs take very different times.
+void runJobs(const std::vector<int>& jobs, int numberOfThreads, const std::function<void(int)>& job);
@@ -0,0 +1,670 @@
+#include "iostream"
+#include "fstream"
+#include "cstring"
+#include "exception"
+#include "algorithm"
+
+#ifdef _WIN32
+#include "windows.h"
+#else
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "fcntl.h"
+#include "unistd.h"
+#endif
+
+#include "trace.h"
+#include "decompress.h"
+#include "threadpool.h"
+
+using namespace std;
+
+#define HexWordsPerRun 256 //Number of words parseHexWords() converts before they are decoded
+
+static hexParser textHexParser = fastestHexParser();
+
+//Decode table
+/** An instruction is one 16 bit word: opcode bits 15-11, Rd bits 10-8, Rs bits 7-5, Rt bits 4-2, immediate bits 7-0.
+	The type of FU and the format only depend on the opcode (opcodeDescriptions), and the format tells which fields the
+	instruction uses. The decode table holds the decoded instruction of every one of the 65536 words, so decoding a word
+	is one indexed load. The table is built at compile time when the compiler evaluates C++14 constexpr functions, else
+	when the program starts (Visual Studio 2015). Clang stops a constant evaluation after a million steps, it builds the
+	table at start up as well.
+**/
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201304 && !defined(__clang__)
+#define DecodeTableConstexpr constexpr
+#else
+#define DecodeTableConstexpr
+#endif
+
+#define NoFunctionalUnit -1 //no FU executes the opcode, its instructions are skipped
+#define NoFormat -1 //the opcode has a FU but no format, its instructions are an error
+
+struct opcodeDescription {
+	const char* name;
+	int functionalUnitType;
+	int format;
+};
+
+static constexpr opcodeDescription opcodeDescriptions[NumberOfOpcodes] = {
+	{ "add", IntegerIndex, RFormat },
+	{ "sub", IntegerIndex, RFormat },
+	{ "and", IntegerIndex, RFormat },
+	{ "nor", IntegerIndex, RFormat },
+	{ "div", DividerIndex, RFormat },
+	{ "mul", MultiplierIndex, RFormat },
+	{ "mod", DividerIndex, RFormat },
+	{ "exp", DividerIndex, RFormat },
+	{ "lw", LoadIndex, LoadFormat },
+	{ "sw", StoreIndex, StoreFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+	{ "halt", IntegerIndex, HaltFormat },
+	{ "put", IntegerIndex, PutFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+	{ "liz", IntegerIndex, IFormat },
+	{ "lis", IntegerIndex, IFormat },
+	{ "lui", IntegerIndex, LuiFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+	{ "unknown", NoFunctionalUnit, NoFormat },
+};
+
+enum wordKind { DecodedWord, UnknownWord, InvalidWord };
+
+struct decodeTableEntry {
+	decodedInstruction instruction;
+	unsigned char kind = UnknownWord; //wordKind
+};
+
+//Decoded instruction of one word, from the description of its opcode
+static DecodeTableConstexpr decodeTableEntry decodeTableWord(unsigned int word)
+{
+	decodeTableEntry entry;
+	unsigned char opcode = (unsigned char)(word >> 11);
+	const opcodeDescription& description = opcodeDescriptions[opcode];
+	if (description.functionalUnitType == NoFunctionalUnit)
+	{
+		return entry;
+	}
+	if (description.format == NoFormat)
+	{
+		entry.kind = InvalidWord;
+		return entry;
+	}
+	signed char rd = (signed char)((word >> 8) & 7); //bit[10-8]
+	signed char rs = (signed char)((word >> 5) & 7); //bit[7-5]
+	signed char rt = (signed char)((word >> 2) & 7); //bit[4-2]
+	unsigned char immediate = (unsigned char)(word & 0xff); //bit[7-0]
+	decodedInstruction& instruction = entry.instruction;
+	instruction.opcode = opcode;
+	instruction.functionalUnitType = (unsigned char)description.functionalUnitType;
+	instruction.format = (unsigned char)description.format;
+	switch (description.format)
+	{
+	case RFormat:
+		instruction.destination = rd;
+		instruction.source1 = rs;
+		instruction.source2 = rt;
+		break;
+	case LoadFormat:
+		instruction.destination = rd;
+		instruction.source1 = rs;
+		break;
+	case StoreFormat:
+		instruction.source1 = rt;
+		instruction.source2 = rs;
+		break;
+	case IFormat:
+		instruction.destination = rd;
+		instruction.immediate = immediate;
+		break;
+	case LuiFormat:
+		instruction.destination = rd;
+		instruction.source1 = rd;
+		instruction.immediate = immediate;
+		break;
+	case PutFormat:
+		instruction.source1 = rs;
+		break;
+	default: //HaltFormat
+		break;
+	}
+	entry.kind = DecodedWord;
+	return entry;
+}
+
+struct decodeTable {
+	decodeTableEntry entries[1 << 16];
+
+	DecodeTableConstexpr decodeTable() : entries()
+	{
+		for (unsigned int word = 0; word < (1 << 16); word++)
+		{
+			entries[word] = decodeTableWord(word);
+		}
+	}
+};
+
+static DecodeTableConstexpr const decodeTable wordTable;
+
+const char* opcodeName(int opcode)
+{
+	return opcode >= 0 && opcode < NumberOfOpcodes ? opcodeDescriptions[opcode].name : "unknown";
+}
+
+bool decodeWord(unsigned short word, decodedInstruction& currentInstruction, bool& error)
+{
+	const decodeTableEntry& entry = wordTable.entries[word];
+	error = entry.kind == InvalidWord;
+	if (entry.kind != DecodedWord) //if the instruction is not using any of the known FU, ignore it
+	{
+		return false;
+	}
+	currentInstruction = entry.instruction;
+	return true;
+}
+
+//decodeInstruction() without the error message, the decoding threads leave it to the caller
+static bool decodeLine(const std::string& line, decodedInstruction& currentInstruction, bool& error)
+{
+	error = false;
+	if ((line.length() > 0) && line[0] != '#')
+	{
+		return decodeWord(std::stoi(line, nullptr, 16), currentInstruction, error);
+	}
+	return false;
+}
+
+bool decodeInstruction(const std::string& line, decodedInstruction& currentInstruction, bool& error)
+{
+	bool decoded = decodeLine(line, currentInstruction, error);
+	if (error)
+	{
+		cout << "Error: Invalid opcode";
+	}
+	return decoded;
+}
+
+//Decode the lines of one chunk, like the lines read by getline(). The runs of lines of 4 hex digits go through
+//parseHexWords(), the other lines through decodeInstruction()
+//returns false at the first line which is an error for decodeInstruction(), nothing is printed
+static bool decodeLines(const char* text, const char* end, std::vector<decodedInstruction>& instructions)
+{
+	string line;
+	decodedInstruction currentInstruction;
+	unsigned short words[HexWordsPerRun];
+	while (text < end)
+	{
+		std::size_t consumed;
+		std::size_t count = parseHexWords(textHexParser, text, end - text, words, HexWordsPerRun, consumed);
+		for (std::size_t i = 0; i < count; i++)
+		{
+			bool error = false;
+			if (decodeWord(words[i], currentInstruction, error))
+			{
+				instructions.push_back(currentInstruction);
+			}
+			else if (error)
+			{
+				return false;
+			}
+		}
+		text += consumed;
+		if (count == HexWordsPerRun || text == end)
+		{
+			continue;
+		}
+		const char* lineEnd = (const char*)memchr(text, '\n', end - text);
+		if (lineEnd == nullptr)
+		{
+			lineEnd = end; //last line of the trace, without end of line
+		}
+		line.assign(text, lineEnd);
+		bool error = false;
+		if (decodeLine(line, currentInstruction, error))
+		{
+			instructions.push_back(currentInstruction);
+		}
+		else if (error)
+		{
+			return false;
+		}
+		text = lineEnd == end ? end : lineEnd + 1;
+	}
+	return true;
+}
+
+void useHexParser(hexParser parser)
+{
+	textHexParser = parser;
+}
+
+bool decodeTraceText(const char* text, std::size_t size, int numberOfThreads, std::vector<decodedInstruction>& instructions)
+{
+	int numberOfChunks = (int)std::min<std::size_t>(std::max(numberOfThreads, 1), size / TraceTextChunkSize + 1);
+	if (numberOfChunks == 1)
+	{
+		if (decodeLines(text, text + size, instructions) == false)
+		{
+			cout << "Error: Invalid opcode";
+			return false;
+		}
+		return true;
+	}
+	//chunk c starts after the end of line found from c * size / numberOfChunks
+	std::vector<const char*> starts(numberOfChunks + 1, text + size);
+	starts[0] = text;
+	for (int c = 1; c < numberOfChunks; c++)
+	{
+		const char* from = std::max(starts[c - 1], text + c * (size / numberOfChunks));
+		const char* lineEnd = (const char*)memchr(from, '\n', text + size - from);
+		starts[c] = lineEnd == nullptr ? text + size : lineEnd + 1;
+	}
+	std::vector< std::vector<decodedInstruction> > decoded(numberOfChunks);
+	std::vector<char> decodedAll(numberOfChunks, 0);
+	std::vector<std::exception_ptr> exceptions(numberOfChunks);
+	std::vector<int> chunks;
+	for (int c = 0; c < numberOfChunks; c++)
+	{
+		chunks.push_back(c);
+	}
+	runJobs(chunks, numberOfChunks, [&](int c)
+	{
+		try
+		{
+			decoded[c].reserve((starts[c + 1] - starts[c]) / 5 + 1); //a line is usually 4 hex digits and an end of line
+			decodedAll[c] = decodeLines(starts[c], starts[c + 1], decoded[c]);
+		}
+		catch (...)
+		{
+			exceptions[c] = std::current_exception();
+		}
+	});
+	std::size_t total = instructions.size();
+	for (int c = 0; c < numberOfChunks; c++)
+	{
+		total += decoded[c].size();
+	}
+	instructions.reserve(total);
+	//the first failing line of the trace is the one reported, as when the lines are decoded one after the other
+	for (int c = 0; c < numberOfChunks; c++)
+	{
+		instructions.insert(instructions.end(), decoded[c].begin(), decoded[c].end());
+		if (exceptions[c])
+		{
+			std::rethrow_exception(exceptions[c]);
+		}
+		if (decodedAll[c] == 0)
+		{
+			cout << "Error: Invalid opcode";
+			return false;
+		}
+	}
+	return true;
+}
+
+bool traceTextReader::decodeBlock(std::vector<decodedInstruction>& instructions)
+{
+	instructions.clear();
+	while (instructions.empty() && !(endOfInput && text.empty()))
+	{
+		//the block goes on after the cut line of the previous block
+		std::size_t kept = text.size();
+		std::size_t size = kept;
+		if (!endOfInput)
+		{
+			text.resize(kept + TraceTextBlockSize);
+			input->read(text.data() + kept, TraceTextBlockSize);
+			size = kept + (std::size_t)input->gcount();
+			text.resize(size);
+			endOfInput = size < kept + TraceTextBlockSize;
+		}
+		std::size_t end = size;
+		if (!endOfInput)
+		{
+			//the lines after the last end of line are decoded with the next block, a line longer than a block is
+			//read further
+			std::vector<char>::const_iterator lastEnd = std::find(text.rbegin(), text.rend(), '\n').base();
+			end = lastEnd - text.begin();
+		}
+		if (decodeTraceText(text.data(), end, numberOfThreads, instructions) == false)
+		{
+			return false;
+		}
+		text.erase(text.begin(), text.begin() + end);
+	}
+	return true;
+}
+
+bool openStandardInput(traceTextReader& reader, decompressingStream& compressed)
+{
+	char magic[sizeof(traceBinaryHeader::magic)];
+	cin.read(magic, sizeof(magic));
+	std::size_t size = (std::size_t)cin.gcount();
+	if (size == sizeof(magic) && memcmp(magic, TraceBinaryMagic, sizeof(magic)) == 0)
+	{
+		cout << "Error: A binary trace cannot be read from the standard input, give its file name" << endl;
+		return false;
+	}
+	traceCompression compression = compressionOf((const unsigned char*)magic, size);
+	if (compression != NotCompressed)
+	{
+		if (compressed.openStandardInput(std::string(magic, size), compression) == false)
+		{
+			return false;
+		}
+		reader.input = &compressed;
+		return true;
+	}
+	//a trace shorter than the magic ends here, the reader then reads nothing more
+	reader.text.assign(magic, magic + size);
+	reader.input = &cin;
+	return true;
+}
+
+bool isBinaryTrace(const std::string& fileName)
+{
+	char magic[8];
+	ifstream traceFile(fileName, ios::binary);
+	if (!traceFile.read(magic, sizeof(magic)))
+	{
+		return false;
+	}
+	return memcmp(magic, TraceBinaryMagic, sizeof(magic)) == 0;
+}
+
+//The fields are masked to build the word the record comes from, so a field out of its range does not match the decoded one
+bool validInstruction(const decodedInstruction& record)
+{
+	if (record.opcode >= NumberOfOpcodes)
+	{
+		return false;
+	}
+	unsigned int word = record.opcode << 11;
+	switch (record.format)
+	{
+	case RFormat:
+		word |= ((record.destination & 7) << 8) | ((record.source1 & 7) << 5) | ((record.source2 & 7) << 2);
+		break;
+	case LoadFormat:
+		word |= ((record.destination & 7) << 8) | ((record.source1 & 7) << 5);
+		break;
+	case StoreFormat:
+		word |= ((record.source2 & 7) << 5) | ((record.source1 & 7) << 2);
+		break;
+	case IFormat:
+	case LuiFormat:
+		word |= ((record.destination & 7) << 8) | record.immediate;
+		break;
+	case PutFormat:
+		word |= (record.source1 & 7) << 5;
+		break;
+	case HaltFormat:
+		break;
+	default:
+		return false;
+	}
+	decodedInstruction decoded;
+	bool error = false;
+	if (decodeWord((unsigned short)word, decoded, error) == false)
+	{
+		return false;
+	}
+	return decoded.opcode == record.opcode && decoded.functionalUnitType == record.functionalUnitType &&
+		decoded.format == record.format && decoded.destination == record.destination &&
+		decoded.source1 == record.source1 && decoded.source2 == record.source2 && decoded.immediate == record.immediate;
+}
+
+//check the header of a mapped binary trace against the size of the file, every record against the decoder (the
+//pipeline indexes its tables with the FU type and the registers of the records) and the records against the fingerprint
+//of the header: a valid record changed into another one is still another trace
+static bool validateBinaryTrace(mappedTrace& trace)
+{
+	if (trace.mappingSize < sizeof(traceBinaryHeader))
+	{
+		cout << "Error: Binary trace is truncated" << endl;
+		return false;
+	}
+	const traceBinaryHeader* header = (const traceBinaryHeader*)trace.mapping;
+	if (memcmp(header->magic, TraceBinaryMagic, sizeof(header->magic)) != 0)
+	{
+		cout << "Error: Not a binary trace" << endl;
+		return false;
+	}
+	if (header->version != TraceBinaryVersion || header->recordSize != sizeof(decodedInstruction))
+	{
+		cout << "Error: Unsupported binary trace version " << header->version << endl;
+		return false;
+	}
+	if (trace.mappingSize != sizeof(traceBinaryHeader) + header->instructionCount * sizeof(decodedInstruction))
+	{
+		cout << "Error: Binary trace size does not match its header" << endl;
+		return false;
+	}
+	const decodedInstruction* instructions = (const decodedInstruction*)((const char*)trace.mapping + sizeof(traceBinaryHeader));
+	unsigned long long fingerprint = TraceFingerprintSeed;
+	for (unsigned long long i = 0; i < header->instructionCount; i++)
+	{
+		if (validInstruction(instructions[i]) == false)
+		{
+			cout << "Error: Binary trace record " << i << " is not a valid instruction" << endl;
+			return false;
+		}
+		fingerprint = fingerprintInstruction(fingerprint, instructions[i]);
+	}
+	if (fingerprint != header->fingerprint)
+	{
+		cout << "Error: Binary trace records do not match the fingerprint of its header" << endl;
+		return false;
+	}
+	trace.instructions = instructions;
+	trace.instructionCount = header->instructionCount;
+	return true;
+}
+
+bool loadTrace(const std::string& fileName, loadedTrace& trace, int numberOfThreads)
+{
+	if (fileName != "-" && isBinaryTrace(fileName))
+	{
+		if (mapBinaryTrace(fileName, trace.binary) == false)
+		{
+			return false;
+		}
+		trace.instructions = trace.binary.instructions;
+		trace.instructionCount = trace.binary.instructionCount;
+		return true;
+	}
+	bool loaded = readTraceBlocks(fileName, numberOfThreads, [&trace](const decodedInstruction* instructions, unsigned long long count)
+	{
+		trace.decoded.insert(trace.decoded.end(), instructions, instructions + count);
+	});
+	if (loaded == false)
+	{
+		return false;
+	}
+	trace.instructions = trace.decoded.data();
+	trace.instructionCount = trace.decoded.size();
+	return true;
+}
+
+bool readTraceBlocks(const std::string& fileName, int numberOfThreads,
+	const std::function<void(const decodedInstruction* instructions, unsigned long long count)>& consume)
+{
+	if (fileName != "-" && isBinaryTrace(fileName))
+	{
+		mappedTrace binary;
+		if (mapBinaryTrace(fileName, binary) == false)
+		{
+			return false;
+		}
+		consume(binary.instructions, binary.instructionCount);
+		unmapBinaryTrace(binary);
+		return true;
+	}
+	ifstream traceFile;
+	decompressingStream compressedFile;
+	traceTextReader reader;
+	traceCompression compression = fileName != "-" ? compressionOf(fileName) : NotCompressed;
+	if (fileName == "-")
+	{
+		if (openStandardInput(reader, compressedFile) == false)
+		{
+			return false;
+		}
+	}
+	else if (compression != NotCompressed)
+	{
+		if (compressedFile.open(fileName, compression) == false)
+		{
+			return false;
+		}
+		reader.input = &compressedFile;
+	}
+	else
+	{
+		traceFile.open(fileName);
+		if (!traceFile.is_open())
+		{
+			cout << "Cannot read the input file";
+			return false;
+		}
+		reader.input = &traceFile;
+	}
+	reader.numberOfThreads = numberOfThreads > 0 ? numberOfThreads : defaultNumberOfThreads();
+	std::vector<decodedInstruction> block;
+	do
+	{
+		if (reader.decodeBlock(block) == false)
+		{
+			return false;
+		}
+		consume(block.data(), block.size());
+	} while (!block.empty());
+	if (compressedFile.failed())
+	{
+		cout << "Error: The compressed trace is corrupt or truncated" << endl;
+		return false;
+	}
+	return true;
+}
+
+void unloadTrace(loadedTrace& trace)
+{
+	if (trace.binary.mapping != nullptr)
+	{
+		unmapBinaryTrace(trace.binary);
+	}
+	trace.decoded = std::vector<decodedInstruction>();
+	trace.instructions = nullptr;
+	trace.instructionCount = 0;
+}
+
+#ifdef _WIN32
+
+bool mapBinaryTrace(const std::string& fileName, mappedTrace& trace)
+{
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		cout << "Cannot read the input file";
+		return false;
+	}
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	trace.fileHandle = file;
+	trace.mappingSize = size.QuadPart;
+	trace.mappingHandle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (trace.mappingHandle != NULL)
+	{
+		trace.mapping = MapViewOfFile((HANDLE)trace.mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	}
+	if (trace.mapping == nullptr)
+	{
+		cout << "Cannot map the input file";
+		unmapBinaryTrace(trace);
+		return false;
+	}
+	if (validateBinaryTrace(trace) == false)
+	{
+		unmapBinaryTrace(trace);
+		return false;
+	}
+	return true;
+}
+
+void unmapBinaryTrace(mappedTrace& trace)
+{
+	if (trace.mapping != nullptr)
+	{
+		UnmapViewOfFile(trace.mapping);
+	}
+	if (trace.mappingHandle != nullptr)
+	{
+		CloseHandle((HANDLE)trace.mappingHandle);
+	}
+	if (trace.fileHandle != nullptr)
+	{
+		CloseHandle((HANDLE)trace.fileHandle);
+	}
+	trace = mappedTrace();
+}
+
+#else
+
+bool mapBinaryTrace(const std::string& fileName, mappedTrace& trace)
+{
+	int file = open(fileName.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		cout << "Cannot read the input file";
+		return false;
+	}
+	struct stat fileStatus;
+	if (fstat(file, &fileStatus) != 0 || fileStatus.st_size == 0)
+	{
+		cout << "Error: Binary trace is truncated" << endl;
+		close(file);
+		return false;
+	}
+	trace.mappingSize = fileStatus.st_size;
+	void* mapping = mmap(nullptr, trace.mappingSize, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file); //the mapping keeps its own reference to the file
+	if (mapping == MAP_FAILED)
+	{
+		cout << "Cannot map the input file";
+		trace = mappedTrace();
+		return false;
+	}
+	trace.mapping = mapping;
+	//the pipeline reads the trace front to back exactly once
+	madvise(trace.mapping, trace.mappingSize, MADV_SEQUENTIAL);
+	if (validateBinaryTrace(trace) == false)
+	{
+		unmapBinaryTrace(trace);
+		return false;
+	}
+	return true;
+}
+
+void unmapBinaryTrace(mappedTrace& trace)
+{
+	if (trace.mapping != nullptr)
+	{
+		munmap(trace.mapping, trace.mappingSize);
+	}
+	trace = mappedTrace();
+}
+
+#endif
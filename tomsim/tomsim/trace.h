@@ -0,0 +1,179 @@
+#pragma once
+
+#include "string"
+#include "vector"
+#include "istream"
+#include "functional"
+#include "cstring"
+
+#include "hexparse.h"
+
+#define IntegerIndex 0
+#define DividerIndex 1
+#define MultiplierIndex 2
+#define LoadIndex 3
+#define StoreIndex 4
+#define FUType 5 //Number of Functional Unit type
+
+//Format of a decoded instruction, tells the pipeline which register fields are used
+enum instructionFormat { RFormat, IFormat, LoadFormat, StoreFormat, LuiFormat, PutFormat, HaltFormat };
+
+#define NumberOfOpcodes 32 //the opcode field has 5 bits
+#define NoRegister -1 //value of a register field which is not used by the instruction format
+#define NumberOfRegisters 8
+
+//Decoded instruction. It is a small POD so the trace window and the active instructions hold it by value
+/** R format instruction (add, sub, and, nor, div, mul, mod, exp)
+		destination: Rd, source1: Rs, source2: Rt
+	I format instruction (liz, lis)
+		destination: Rd, immediate: bit[7-0]
+	Load format instruction (lw $rd, $rs)
+		destination: Rd, source1: Rs
+	Store format instruction (sw $rt, $rs)
+		source1: Rt, source2: Rs
+	Lui format instruction (lui $rd)
+		destination: Rd, source1: Rd, immediate: bit[7-0]
+	Put format instruction (put $rs)
+		source1: Rs
+	Halt format instruction
+**/
+struct decodedInstruction {
+	unsigned char opcode = 0;
+	unsigned char functionalUnitType = 0; //index of the type of functional unit required by this instruction
+	unsigned char format = 0; //instructionFormat
+	signed char destination = NoRegister;
+	signed char source1 = NoRegister;
+	signed char source2 = NoRegister;
+	unsigned char immediate = 0;
+};
+static_assert(sizeof(decodedInstruction) <= 8, "decodedInstruction must stay packed");
+
+#define TraceFingerprintSeed 0xcbf29ce484222325ULL //fingerprint of a trace before its first instruction
+
+//Hash of a sequence of instructions with one more instruction, an FNV-style hash over their records
+inline unsigned long long fingerprintInstruction(unsigned long long fingerprint, const decodedInstruction& inst)
+{
+	unsigned long long word = 0;
+	memcpy(&word, &inst, sizeof(inst));
+	return (fingerprint ^ word) * 0x100000001b3ULL;
+}
+
+//Binary trace file (.tbin)
+/** header (32 bytes, little endian)
+		char[8]: magic "TOMSIMTB"
+		uint32: version (TraceBinaryVersion)
+		uint32: size of one record, sizeof(decodedInstruction)
+		uint64: number of instructions
+		uint64: fingerprint of the instructions (fingerprintInstruction() over each of them, from TraceFingerprintSeed)
+	followed by the decoded instructions, one decodedInstruction record each, in trace order.
+	Lines which readTraceFile() skips (comments, empty lines, unknown FU) are not stored.
+**/
+#define TraceBinaryMagic "TOMSIMTB"
+#define TraceBinaryVersion 3 //version 1 records have no immediate, version 2 headers have no fingerprint
+
+struct traceBinaryHeader {
+	char magic[8];
+	unsigned int version;
+	unsigned int recordSize;
+	unsigned long long instructionCount;
+	unsigned long long fingerprint;
+};
+static_assert(sizeof(traceBinaryHeader) == 32, "traceBinaryHeader is part of the file format");
+
+//Read only view of a binary trace mapped in memory
+struct mappedTrace {
+	const decodedInstruction* instructions = nullptr;
+	unsigned long long instructionCount = 0;
+	void* mapping = nullptr; //start of the mapped file
+	unsigned long long mappingSize = 0;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
+
+//Mnemonic of an opcode, "unknown" if no FU executes it
+const char* opcodeName(int opcode);
+
+//Decode one 16 bit instruction into currentInstruction, a lookup in the decode table
+//returns false if no FU executes its opcode, 'error' is set if the opcode has a FU but no format
+bool decodeWord(unsigned short word, decodedInstruction& currentInstruction, bool& error);
+
+//returns true if the record is what decodeWord() gives for the word it comes from, so the pipeline can index its tables
+//with its FU type and its registers. Used on the records read from a file
+bool validInstruction(const decodedInstruction& record);
+
+//Decode one line of the trace into currentInstruction, the 4 hex digits of the line go through decodeWord()
+//returns false if the line is not an instruction the simulator knows about (comment, empty line or unknown FU)
+bool decodeInstruction(const std::string& line, decodedInstruction& currentInstruction, bool& error);
+
+//Parallel decoding of the text traces
+/** A text trace is read in blocks of TraceTextBlockSize bytes cut at the end of a line. Each block is split at line
+	boundaries into one chunk per thread, chunks are at least TraceTextChunkSize bytes so a small trace is decoded on one
+	thread. Every chunk is decoded into its own buffer and the buffers are appended in order. In a chunk, the runs of lines
+	of 4 hex digits are converted by parseHexWords() (see hexparse.h), the other lines go through decodeInstruction().
+	The lines are the ones getline() gives, so comments, empty lines and unknown opcodes are skipped as before.
+**/
+#define TraceTextBlockSize (8 * 1024 * 1024)
+#define TraceTextChunkSize (256 * 1024)
+
+//Parser of the lines of 4 hex digits used by decodeTraceText(), fastestHexParser() by default. The parser must be
+//supported by the processor, see hexparse.h
+void useHexParser(hexParser parser);
+
+//Decode the lines of 'text' on up to numberOfThreads threads, the instructions are appended to 'instructions'
+//returns false if a line is an error for decodeInstruction(). An exception of decodeInstruction() is thrown again
+//by the calling thread, for the first line which throws
+bool decodeTraceText(const char* text, std::size_t size, int numberOfThreads, std::vector<decodedInstruction>& instructions);
+
+//Text trace read block by block, every block is decoded in parallel
+struct traceTextReader {
+	std::istream* input = nullptr;
+	int numberOfThreads = 1;
+	std::vector<char> text; //between two blocks, the start of the line cut by the end of the block
+	bool endOfInput = false;
+
+	//Decode the next block of the trace, its instructions replace the ones of the previous block.
+	//'instructions' is only empty once the whole trace is decoded
+	//returns false if a line is an error for decodeInstruction()
+	bool decodeBlock(std::vector<decodedInstruction>& instructions);
+};
+
+class decompressingStream;
+
+//Read a trace from the standard input with 'reader'. Its first bytes tell a text trace from a compressed one: a gzip or
+//zstd trace is decompressed by 'compressed', the first bytes of a text trace are kept in the reader
+//returns false if the standard input is a binary trace, which must be mapped from its file, or a compressed trace this
+//build cannot decompress
+bool openStandardInput(traceTextReader& reader, decompressingStream& compressed);
+
+//returns true if the file starts with the binary trace magic
+bool isBinaryTrace(const std::string& fileName);
+
+//Map a binary trace in memory. The records are used in place, nothing is copied
+//returns true if the file is mapped, its header is valid, every record is an instruction decodeWord() gives and the
+//records have the fingerprint of the header
+bool mapBinaryTrace(const std::string& fileName, mappedTrace& trace);
+void unmapBinaryTrace(mappedTrace& trace);
+
+//Whole trace in memory, decoded once and then only read, so several simulators can share it
+//A binary trace is mapped, a text trace is decoded into 'decoded'
+struct loadedTrace {
+	const decodedInstruction* instructions = nullptr;
+	unsigned long long instructionCount = 0;
+	std::vector<decodedInstruction> decoded;
+	mappedTrace binary;
+};
+
+//Load a whole trace, "-" reads it from the standard input. A text trace is decoded on numberOfThreads threads, 0 for
+//one per hardware thread
+//returns true if everything runs smoothly, else false
+bool loadTrace(const std::string& fileName, loadedTrace& trace, int numberOfThreads = 0);
+void unloadTrace(loadedTrace& trace);
+
+//Read a trace once from its start to its end, "-" reads it from the standard input. 'consume' gets the instructions
+//block by block: a text trace is decoded one block at a time on numberOfThreads threads (0 for one per hardware thread)
+//so only one block is in memory, a binary trace is mapped and given as a single block
+//returns true if everything runs smoothly, else false
+bool readTraceBlocks(const std::string& fileName, int numberOfThreads,
+	const std::function<void(const decodedInstruction* instructions, unsigned long long count)>& consume);
@@ -0,0 +1,101 @@
+#include "iostream"
+#include "string"
+#include "vector"
+
+#include "simulator.h"
+
+using namespace std;
+
+void Simulator::checkOutcome(int slot)
+{
+	instruction& currentInstruction = activeInstructions.slots[slot];
+	reservationStation& r = ReservationStations[currentInstruction.FunctionalUnitType][currentInstruction.ReservationStation];
+	const decodedInstruction& inst = currentInstruction.inst;
+	unsigned long long position = currentInstruction.CCFetched - 1;
+	const instructionOutcome& expected = currentInstruction.expected;
+	signed short value = 0;
+	unsigned short address = expected.address;
+	switch (inst.format)
+	{
+	case LoadFormat:
+		address = r.source1Value;
+		value = memory[address];
+		break;
+	case StoreFormat:
+		address = r.source2Value;
+		value = r.source1Value;
+		break;
+	case PutFormat:
+		value = r.source1Value;
+		break;
+	case HaltFormat:
+		break;
+	default:
+		value = computeValue(inst, r.source1Value, r.source2Value);
+		break;
+	}
+	checkedInstructions += 1;
+	if (value != expected.value || address != expected.address)
+	{
+		//only the value a load gets from the memory depends on the order of the memory accesses
+		bool memoryOrder = inst.format == LoadFormat && address == expected.address;
+		if (memoryOrder)
+		{
+			memoryOrderMismatches += 1;
+		}
+		else
+		{
+			dataflowMismatches += 1;
+		}
+		if (firstMismatches.size() < MaxReportedMismatches)
+		{
+			firstMismatches.push_back({ position, inst.opcode, expected.value, value, expected.address, address, memoryOrder });
+		}
+		value = expected.value;
+		if (inst.format == StoreFormat)
+		{
+			r.source1Value = expected.value;
+			r.source2Value = expected.address;
+		}
+	}
+	r.result = value;
+}
+
+void Simulator::printCheckReport(std::ostream& report)
+{
+	report << "Check: " << checkedInstructions << " instructions, " << memoryOrderMismatches + dataflowMismatches << " wrong values";
+	if (memoryOrderMismatches + dataflowMismatches > 0)
+	{
+		report << " (" << memoryOrderMismatches << " memory order, " << dataflowMismatches << " dataflow)";
+	}
+	report << endl;
+	for (const valueMismatch& mismatch : firstMismatches)
+	{
+		report << "instruction " << mismatch.position << " " << opcodeName(mismatch.opcode) << ": expected " << mismatch.expected
+			<< ", got " << mismatch.value;
+		if (mismatch.address != mismatch.expectedAddress)
+		{
+			report << ", address expected " << mismatch.expectedAddress << ", got " << mismatch.address;
+		}
+		report << (mismatch.memoryOrder ? ", memory order" : "") << endl;
+	}
+	for (int i = 0; i < NumberOfRegisters; i++)
+	{
+		if (registers[i] != functionalModel.registers[i])
+		{
+			report << "register " << i << ": expected " << functionalModel.registers[i] << ", got " << registers[i] << endl;
+		}
+	}
+	int differentWords = 0;
+	for (int address = 0; address < MemoryWords; address++)
+	{
+		if (memory[address] != functionalModel.memory[address])
+		{
+			differentWords += 1;
+		}
+	}
+	if (differentWords > 0)
+	{
+		report << "memory: " << differentWords << " words differ from the functional model" << endl;
+	}
+}